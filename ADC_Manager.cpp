@@ -7,6 +7,7 @@
 //
 #include "ADC_Manager.h"
 #include "Critical.h"
+#include "Driver.h"
 #include "Code_Assurance.h"
 
 //
@@ -20,6 +21,13 @@ ADC_Manager::ADC_Manager( void ) {
 		_pending[ i ].next = _free;
 		_free = &( _pending[ i ]);
 	}
+	_channels = 0;
+	_conversions = 0;
+	_sample = 0;
+	_latched = 0;
+	_cursor = 0;
+	_credit = 0;
+	_running = false;
 }
 
 //
@@ -57,9 +65,10 @@ bool ADC_Manager::read( byte pin, Signal *flag, word *result ) {
 	ASSERT( _active != NIL( pending ));
 
 	//
-	//	Fire off conversion if required.
+	//	Fire off conversion if required.  When the sequencer
+	//	is running the ISR will pick up the request.
 	//
-	if( initiate ) MONITOR_ANALOGUE_PIN( _active->pin );
+	if( initiate && !_running ) MONITOR_ANALOGUE_PIN( _active->pin );
 
 	//
 	//	Success!
@@ -68,12 +77,12 @@ bool ADC_Manager::read( byte pin, Signal *flag, word *result ) {
 }
 
 //
-//	This routine is called when an ADC reading has
-//	completed.
+//	Pass a completed reading to the head of the pending
+//	queue.
 //
-void ADC_Manager::store( word value ) {
+void ADC_Manager::complete( word value ) {
 	pending	*ptr;
-	
+
 	if(( ptr = _active )) {
 		//
 		//	Remove from the list.
@@ -89,13 +98,311 @@ void ADC_Manager::store( word value ) {
 		//
 		ptr->next = _free;
 		_free = ptr;
+	}
+}
+
+//
+//	This routine is called when an ADC reading has
+//	completed.
+//
+void ADC_Manager::store( word value ) {
+	if( !_running ) {
+		//
+		//	Single conversion mode, one reading per
+		//	pending request.
+		//
+		complete( value );
 		//
 		//	Kick off the next ADC request?
 		//
 		if( _active ) MONITOR_ANALOGUE_PIN( _active->pin );
+		return;
+	}
+	//
+	//	Free running mode: who does this reading belong to?
+	//
+	_conversions++;
+	if( _sample == pending_slot ) {
+		complete( value );
+	}
+	else {
+		channel	*c;
+
+		c = &( _channel[ _sample ]);
+		if( c->limit &&( value > c->limit )) {
+			//
+			//	Instantaneous overload: power off first and
+			//	ask questions afterwards.
+			//
+			dcc_driver.off( c->driver );
+			c->limit = 0;
+			c->tripped = true;
+			c->tripped_at = micros();
+			if( c->trips < MAXIMUM_WORD ) c->trips++;
+			if( c->flag &&( !c->raised )) {
+				c->raised = true;
+				c->flag->release();
+			}
+		}
+		c->sum += value;
+		if( ++c->count >= c->target ) {
+			c->fine = c->sum >> c->extra;
+			c->sum = 0;
+			c->count = 0;
+		}
+		c->ring[ c->next ] = value;
+		if(( c->next = ( c->next + 1 ) & ring_mask ) == 0 ) {
+			//
+			//	The ring is full of new readings.
+			//
+			if( c->flag ) {
+				if( c->raised ) {
+					if( c->overrun < MAXIMUM_WORD ) c->overrun++;
+				}
+				else {
+					c->raised = true;
+					c->flag->release();
+				}
+			}
+		}
+	}
+	//
+	//	The conversion already under way becomes the next
+	//	sample, and we choose the pin for the conversion
+	//	after that.  A pending request is slotted in as
+	//	soon as there is not one already in the pipeline.
+	//
+	_sample = _latched;
+	if( _active &&( _sample != pending_slot )) {
+		_latched = pending_slot;
+		SELECT_ANALOGUE_PIN( _active->pin );
+	}
+	else {
+		//
+		//	Each channel is given as many consecutive
+		//	conversions as its weight.
+		//
+		if( _credit ) {
+			_credit--;
+		}
+		else {
+			if( ++_cursor >= _channels ) _cursor = 0;
+			_credit = _channel[ _cursor ].weight - 1;
+		}
+		_latched = _cursor;
+		SELECT_ANALOGUE_PIN( _channel[ _cursor ].pin );
+	}
+}
+
+//
+//	Add a pin to the free running sequence, returning a
+//	handle for the channel (or ERROR_BYTE if the table is
+//	full).
+//
+byte ADC_Manager::subscribe( byte pin, Signal *flag ) {
+	channel	*c;
+	byte	h;
+
+	Critical	code;
+
+	if( _channels >= sequence_channels ) return( ERROR_BYTE );
+	c = &( _channel[( h = _channels++ )]);
+	c->pin = pin;
+	for( byte i = 0; i < ring_size; c->ring[ i++ ] = 0 );
+	c->next = 0;
+	c->flag = flag;
+	c->raised = false;
+	c->overrun = 0;
+	c->driver = 0;
+	c->limit = 0;
+	c->tripped = false;
+	c->tripped_at = 0;
+	c->trips = 0;
+	c->extra = 0;
+	c->target = 1;
+	c->count = 0;
+	c->sum = 0;
+	c->fine = 0;
+	c->weight = 1;
+	return( h );
+}
+
+//
+//	Change (or suspend, with NIL) the flag signalled for
+//	a channel.
+//
+void ADC_Manager::notify( byte handle, Signal *flag ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	_channel[ handle ].flag = flag;
+	_channel[ handle ].raised = false;
+}
+
+//
+//	Start the sequencer free running through the subscribed
+//	channels.
+//
+void ADC_Manager::start( void ) {
+	Critical	code;
+
+	if( _running ||( _channels == 0 )) return;
+	_running = true;
+	_cursor = 0;
+	_credit = _channel[ 0 ].weight - 1;
+	_latched = 0;
+	//
+	//	If a single conversion is under way that is the first
+	//	reading collected, otherwise the first channel will be
+	//	read twice as the pipeline fills, which does no harm.
+	//
+	_sample = _active? pending_slot: 0;
+	SELECT_ANALOGUE_PIN( _channel[ 0 ].pin );
+	FREE_RUN_ANALOGUE();
+}
+
+//
+//	Collect the peak and mean of the readings currently in
+//	a channel ring, re-enabling the notification.
+//
+void ADC_Manager::collect( byte handle, word *peak, word *mean ) {
+	channel	*c;
+	word	p, v;
+	dword	t;
+
+	ASSERT( handle < _channels );
+
+	c = &( _channel[ handle ]);
+	p = 0;
+	t = 0;
+	for( byte i = 0; i < ring_size; i++ ) {
+		{
+			Critical	code;
+
+			v = c->ring[ i ];
+		}
+		if( v > p ) p = v;
+		t += v;
 	}
+	c->raised = false;
+	*peak = p;
+	*mean = (word)( t / ring_size );
 }
 
+//
+//	Return the number of notifications missed on a channel.
+//
+word ADC_Manager::overruns( byte handle ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	return( _channel[ handle ].overrun );
+}
+
+//
+//	Arm (or, with a zero limit, disarm) the instantaneous
+//	overload trip for a channel.
+//
+void ADC_Manager::arm( byte handle, byte driver, word limit ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	_channel[ handle ].driver = driver;
+	_channel[ handle ].limit = limit;
+}
+
+//
+//	Return true (once) if the channel has tripped since the
+//	last call, setting when to the time of the trip.
+//
+bool ADC_Manager::tripped( byte handle, dword *when ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	if( !_channel[ handle ].tripped ) return( false );
+	_channel[ handle ].tripped = false;
+	*when = _channel[ handle ].tripped_at;
+	return( true );
+}
+
+//
+//	Return the number of times a channel has tripped.
+//
+word ADC_Manager::trips( byte handle ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	return( _channel[ handle ].trips );
+}
+
+//
+//	Set the number of extra bits of resolution obtained by
+//	oversampling a channel.
+//
+void ADC_Manager::oversample( byte handle, byte bits ) {
+	channel	*c;
+
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	if( bits > maximum_extra_bits ) bits = maximum_extra_bits;
+	c = &( _channel[ handle ]);
+	c->extra = bits;
+	c->target = 1 << ( bits << 1 );
+	c->count = 0;
+	c->sum = 0;
+	c->fine = 0;
+}
+
+//
+//	Return the latest oversampled reading of a channel and
+//	the number of bits of resolution it has.
+//
+word ADC_Manager::fine( byte handle ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	return( _channel[ handle ].fine );
+}
+
+byte ADC_Manager::resolution( byte handle ) {
+	ASSERT( handle < _channels );
+
+	return( 10 + _channel[ handle ].extra );
+}
+
+//
+//	Return the number of conversions completed since the
+//	last call.
+//
+word ADC_Manager::conversions( void ) {
+	Critical	code;
+	word		c;
+
+	c = _conversions;
+	_conversions = 0;
+	return( c );
+}
+
+//
+//	Set the scheduling weight of a channel.
+//
+void ADC_Manager::weight( byte handle, byte weight ) {
+	Critical	code;
+
+	ASSERT( handle < _channels );
+
+	if( weight < 1 ) weight = 1;
+	if( weight > maximum_weight ) weight = maximum_weight;
+	_channel[ handle ].weight = weight;
+}
 
 //
 //	Declare the ADC Manager itself.
@@ -17,12 +17,41 @@
 #define MAXIMUM_ADC_QUEUE	16
 #endif
 
+//
+//	Define the number of channels the free running sequencer
+//	can cycle through (one per district), and the number of
+//	samples retained for each channel (this must be a power
+//	of 2).
+//
+#ifndef ADC_SEQUENCE_CHANNELS
+#define ADC_SEQUENCE_CHANNELS	SELECT_SML(2,8,8)
+#endif
+#ifndef ADC_RING_SIZE
+#define ADC_RING_SIZE		8
+#endif
 
 //
 //	Macro to set the input pin the ADC will continuously read until
-//	called to read another pin.
+//	called to read another pin.  On MCUs with more than 8 analogue
+//	inputs (the Mega) the MUX5 bit in ADCSRB selects the upper 8.
+//
+//	These are written as expressions so that they are safe to use
+//	as the body of an if statement.
 //
-#define MONITOR_ANALOGUE_PIN(p)		ADMUX=bit(REFS0)|((p)&0x07);ADCSRA|=bit(ADSC)|bit(ADIE)
+#ifdef MUX5
+#define SELECT_ANALOGUE_PIN(p)		(ADCSRB=((p)&0x08)?(ADCSRB|bit(MUX5)):(ADCSRB&~bit(MUX5))),(ADMUX=bit(REFS0)|((p)&0x07))
+#else
+#define SELECT_ANALOGUE_PIN(p)		(ADMUX=bit(REFS0)|((p)&0x07))
+#endif
+#define MONITOR_ANALOGUE_PIN(p)		SELECT_ANALOGUE_PIN(p),(ADCSRA|=bit(ADSC)|bit(ADIE))
+
+//
+//	Macro to place the ADC into free running mode starting with
+//	the currently selected pin.  Once running, any change to the
+//	selected pin is taken up by the conversion *after* the one
+//	currently in progress.
+//
+#define FREE_RUN_ANALOGUE()		(ADCSRB&=~(bit(ADTS2)|bit(ADTS1)|bit(ADTS0))),(ADCSRA|=bit(ADATE)|bit(ADSC)|bit(ADIE))
 
 //
 //	The AVR Analogue to Digital Conversion management class.
@@ -68,6 +97,102 @@ private:
 			**_tail,
 			*_free;
 
+	//
+	//	Define the free running sequencer parameters.
+	//
+	static const byte	sequence_channels = ADC_SEQUENCE_CHANNELS;
+	static const byte	ring_size = ADC_RING_SIZE;
+	static const byte	ring_mask = ring_size - 1;
+
+	//
+	//	The value used in the conversion pipeline to indicate
+	//	a conversion belonging to the head of the pending
+	//	queue rather than a sequenced channel.
+	//
+	static const byte	pending_slot = ERROR_BYTE - 1;
+
+	//
+	//	Each channel being sequenced has the following record,
+	//	filled in by the ISR with every conversion.
+	//
+	struct channel {
+		//
+		//	The analogue pin being read.
+		//
+		byte		pin;
+		//
+		//	The ring of most recent readings and the index
+		//	where the next one will be placed.
+		//
+		word		ring[ ring_size ];
+		volatile byte	next;
+		//
+		//	The subscriber is signalled each time the ring is
+		//	filled.  Signals are not stacked up: a subscriber
+		//	is not signalled again until it has collected the
+		//	readings.  Missed notifications are counted.
+		//
+		Signal		*flag;
+		volatile bool	raised;
+		volatile word	overrun;
+		//
+		//	The instantaneous overload trip.  When limit is
+		//	non-zero any reading above it turns off the
+		//	driver directly from the ISR, disarms the trip
+		//	and signals the subscriber.  The time of the trip
+		//	(in microseconds) is kept so the delay before the
+		//	subscriber responds can be measured.
+		//
+		byte		driver;
+		volatile word	limit;
+		volatile bool	tripped;
+		volatile dword	tripped_at;
+		volatile word	trips;
+		//
+		//	Oversampling and decimation.  Every conversion is
+		//	added to sum, and after target (4 to the power of
+		//	the extra bits) conversions the sum is scaled down
+		//	to give a reading with the extra bits of resolution
+		//	in fine.
+		//
+		byte		extra,
+				target,
+				count;
+		word		sum;
+		volatile word	fine;
+		//
+		//	The scheduling weight: the number of consecutive
+		//	conversions the channel is given each time round
+		//	the sequence.
+		//
+		volatile byte	weight;
+	};
+
+	//
+	//	The channel table and the state of the sequencer.
+	//
+	//	The ADC latches the selected pin at the start of each
+	//	conversion, so in free running mode there are always
+	//	two conversions "in flight": the one which has just
+	//	completed (_sample) and the one already started
+	//	(_latched).  _cursor is the last channel selected
+	//	from the sequence.
+	//
+	channel		_channel[ sequence_channels ];
+	byte		_channels;
+	volatile word	_conversions;
+	volatile byte	_sample,
+			_latched,
+			_cursor,
+			_credit;
+	bool		_running;
+
+	//
+	//	Pass a completed reading to the head of the pending
+	//	queue.
+	//
+	void complete( word value );
+
 
 public:
 	//
@@ -82,6 +207,94 @@ public:
 	//
 	bool read( byte pin, Signal *flag, word *result );
 
+	//
+	//	Add a pin to the free running sequence, returning a
+	//	handle for the channel (or ERROR_BYTE if the table is
+	//	full).  The flag is released every time a full ring
+	//	of new readings is available.
+	//
+	byte subscribe( byte pin, Signal *flag );
+
+	//
+	//	Change (or suspend, with NIL) the flag signalled for
+	//	a channel.
+	//
+	void notify( byte handle, Signal *flag );
+
+	//
+	//	Start the sequencer free running through the subscribed
+	//	channels.  Pending single readings continue to be
+	//	serviced, taking the next available conversion slot.
+	//
+	void start( void );
+
+	//
+	//	Collect the peak and mean of the readings currently in
+	//	a channel ring, re-enabling the notification.
+	//
+	void collect( byte handle, word *peak, word *mean );
+
+	//
+	//	Return the number of notifications missed on a channel
+	//	because the subscriber had not collected the previous
+	//	readings.
+	//
+	word overruns( byte handle );
+
+	//
+	//	Arm (or, with a zero limit, disarm) the instantaneous
+	//	overload trip for a channel.  The hardware latency of
+	//	the trip is fixed at the time taken to complete the
+	//	current conversion plus the ISR entry.
+	//
+	void arm( byte handle, byte driver, word limit );
+
+	//
+	//	Return true (once) if the channel has tripped since the
+	//	last call, setting when to the time of the trip.
+	//
+	bool tripped( byte handle, dword *when );
+
+	//
+	//	Return the number of times a channel has tripped.
+	//
+	word trips( byte handle );
+
+	//
+	//	Set the number of extra bits of resolution (0 to
+	//	maximum_extra_bits) obtained by oversampling a channel.
+	//	Each extra bit costs four times the conversions, so the
+	//	fine reading is updated at the channel's conversion
+	//	rate divided by 4, 16 or 64.
+	//
+	static const byte	maximum_extra_bits = 3;
+	void oversample( byte handle, byte bits );
+
+	//
+	//	Return the latest oversampled reading of a channel and
+	//	the number of bits of resolution it has.
+	//
+	word fine( byte handle );
+	byte resolution( byte handle );
+
+	//
+	//	Return the number of conversions completed since the
+	//	last call (so the cost of oversampling can be seen).
+	//	The count is reset by each call, so Stats is its only
+	//	reader and everything else uses stats.conversions().
+	//
+	word conversions( void );
+
+	//
+	//	Set the scheduling weight of a channel (1 to
+	//	maximum_weight).  The ADC converts at a fixed rate, so
+	//	this shares out a fixed budget of conversions: a channel
+	//	with weight w receives w/W of them, where W is the total
+	//	weight of all channels.
+	//
+	static const byte	maximum_weight = 8;
+	void weight( byte handle, byte weight );
+
 	//
 	//	This routine is called when an ADC reading has
 	//	completed.
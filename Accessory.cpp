@@ -0,0 +1,73 @@
+//
+//	Accessory.cpp
+//	=============
+//
+//	Module to cache the last state sent to accessory
+//	decoders.
+//
+
+
+#include "Accessory.h"
+
+//
+//	Initialise the cache empty.
+//
+Accessory::Accessory( void ) {
+	for( byte i = 0; i < cache_size; i++ ) {
+		_record[ i ].target = 0;
+		_record[ i ].state = DCC_Constant::accessory_off;
+	}
+	_next = 0;
+}
+
+//
+//	Record the state last sent to the target.
+//
+void Accessory::update( word target, byte state ) {
+	cache	*ptr;
+
+	//
+	//	Already known?
+	//
+	for( byte i = 0; i < cache_size; i++ ) {
+		ptr = &( _record[ i ]);
+		if( ptr->target == target ) {
+			ptr->state = state;
+			return;
+		}
+	}
+	//
+	//	No, replace the oldest record.
+	//
+	ptr = &( _record[ _next ]);
+	if(( _next += 1 ) >= cache_size ) _next = 0;
+	ptr->target = target;
+	ptr->state = state;
+}
+
+//
+//	Return the number of records in the cache.
+//
+byte Accessory::records( void ) {
+	return( cache_size );
+}
+
+//
+//	Return the state of the cache record at the index supplied.
+//
+bool Accessory::fetch( byte index, word *target, byte *state ) {
+	if( index >= cache_size ) return( false );
+	if( _record[ index ].target == 0 ) return( false );
+	*target = _record[ index ].target;
+	*state = _record[ index ].state;
+	return( true );
+}
+
+//
+//	Declare the accessory cache.
+//
+Accessory accessory_cache;
+
+//
+//	EOF
+//
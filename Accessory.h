@@ -0,0 +1,91 @@
+//
+//	Accessory.h
+//	===========
+//
+//	Module to cache the last state sent to accessory
+//	decoders.
+//
+
+#ifndef _ACCESSORY_H_
+#define _ACCESSORY_H_
+
+//
+//	We will need the following files
+//
+#include "Environment.h"
+#include "Parameters.h"
+#include "Configuration.h"
+#include "DCC_Constant.h"
+
+//
+//	Accessory state cache
+//	---------------------
+//
+//	The DCC accessory commands are "fire and forget" so the
+//	only record of the state of an accessory is the last
+//	command sent to it.  This cache keeps that so it can be
+//	reported back to a host computer.
+//
+//	When the cache is full the oldest entry is replaced.
+//
+class Accessory {
+private:
+	//
+	//	Define the number of cache records.
+	//
+#ifdef ACCESSORY_CACHE_SIZE
+	static constexpr byte	cache_size	= ACCESSORY_CACHE_SIZE;
+#else
+	static constexpr byte	cache_size	= SELECT_SML(8,16,32);
+#endif
+
+	//
+	//	The cached accessory data, a target of zero is
+	//	an empty record.
+	//
+	struct cache {
+		word		target;
+		byte		state;
+	};
+	cache		_record[ cache_size ];
+
+	//
+	//	The next record to be replaced when a new target
+	//	is added.
+	//
+	byte		_next;
+
+public:
+	//
+	//	Initialise the cache empty.
+	//
+	Accessory( void );
+
+	//
+	//	Record the state last sent to the target.
+	//
+	void update( word target, byte state );
+
+	//
+	//	Return the number of records in the cache.
+	//
+	byte records( void );
+
+	//
+	//	Return the state of the cache record at the index (0 to
+	//	records()-1) supplied.  Returns false if the record is
+	//	not in use, true otherwise.
+	//
+	bool fetch( byte index, word *target, byte *state );
+};
+
+//
+//	Define the accessory cache.
+//
+extern Accessory accessory_cache;
+
+#endif
+
+//
+//	EOF
+//
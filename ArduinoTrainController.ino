@@ -487,6 +487,9 @@
 #include "DCC_Constant.h"
 #include "TOD.h"
 #include "Stats.h"
+#include "Telemetry.h"
+#include "Query.h"
+#include "Resync.h"
 #include "HCI.h"
 #include "Signal.h"
 #include "Banner.h"
@@ -536,8 +539,24 @@ void setup( void ) {
 	initialise_constants();
 	districts.initialise();
 	dcc_generator.initialise();
+	(void)twi.scan();
 	hci_control.initialise();
-	protocol.initialise();
+	protocol.initialise( &console, console_control());
+	state_query.initialise();
+	resync.initialise();
+	stats.initialise();
+#ifdef HOST_LINK_DEVICE
+	//
+	//	Task 4: Bring up the dedicated host link and its
+	//	protocol engine.  Telemetry goes to the host link
+	//	when there is one.
+	//
+	initialise_host_link( HOST_LINK_BAUD_RATE );
+	host_protocol.initialise( &host_link, host_link_control());
+	telemetry.initialise( &host_link, &host_protocol );
+#else
+	telemetry.initialise( &console, &protocol );
+#endif
 }
 
 
@@ -546,7 +565,7 @@ void setup( void ) {
 //
 void loop( void ) {
 	//
-	//	Task 4:	Just do it!
+	//	Task 5:	Just do it!
 	//
 	task_manager.run_tasks();
 }
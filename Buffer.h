@@ -170,8 +170,25 @@ public:
 		return( start( code ) && add( a1 ) && add( SPACE ) && add( a2 ) && end());
 	}
 
+	bool format( char code ) {
+		return( start( code ) && end());
+	}
+
 	bool format( char code, word a1, word a2, word a3 ) {
-		return( start( code ) && add( a1 ) && add( SPACE ) && add( a2 ) && add( a3 ) && end());
+		return( start( code ) && add( a1 ) && add( SPACE ) && add( a2 ) && add( SPACE ) && add( a3 ) && end());
+	}
+
+	bool format( char code, word a1, word a2, word a3, word a4, word a5 ) {
+		return( start( code ) && add( a1 ) && add( SPACE ) && add( a2 ) && add( SPACE ) && add( a3 ) && add( SPACE ) && add( a4 ) && add( SPACE ) && add( a5 ) && end());
+	}
+
+	bool format( char code, byte count, const word *value ) {
+		if( !start( code )) return( false );
+		for( byte i = 0; i < count; i++ ) {
+			if( i &&( !add( SPACE ))) return( false );
+			if( !add( value[ i ])) return( false );
+		}
+		return( end());
 	}
 
 	char *buffer( void ) {
@@ -376,11 +376,10 @@ class Byte_Queue_Signal : public Byte_Queue_API {
 				if( _out >= queue_size ) _out = 0;
 				_content--;
 				//
-				//	Announce data has been acquired.
-				//
-				_gate.claim();
-				//
-				//	Done.
+				//	The gate is not claimed here: the reader
+				//	is a task scheduled on the gate and the
+				//	task manager has already claimed it on
+				//	our behalf (one byte per call).
 				//
 				return( data );
 			}
@@ -219,11 +219,9 @@
 //	code to used the "busy ready" status flag from the LCD to time
 //	the data and instruction commands to the LCD.
 //
-//	Note:	At the moment (V0.1.7) this code is written (in the
-//		form of "micro code" in the LCD_TWI_IO module), but the
-//		data read back from the LCD does not seem functional
-//		and the earlier, and simpler, timed delay approach
-//		works reliably.
+//	Note:	This can also be changed at run time, and the LCD
+//		code will fall back to the timed delay approach if the
+//		status reads fail or do not appear to be working.
 //
 //#define _LCD_USE_READ_BUSY_READY_
 
@@ -43,6 +43,9 @@ void initialise_console( USART_line_speed speed ) {
 	//	Set up the serial connection.
 	//
 	console.initialise( 0, speed, CS8, PNone, SBOne, &console_in, &console_out );
+#ifdef CONSOLE_FLOW_CONTROL
+	console.flow_control( CONSOLE_FLOW_CONTROL, CONSOLE_HIGH_WATER, CONSOLE_LOW_WATER, CONSOLE_RTS_PIN );
+#endif
 }
 
 //
@@ -51,6 +54,34 @@ void initialise_console( USART_line_speed speed ) {
 Signal *console_control( void ) {
 	return( console_in.control_signal());
 }
+
+#ifdef HOST_LINK_DEVICE
+//
+//	The HOST LINK device
+//	====================
+//
+static Byte_Queue_Signal< HOST_LINK_INPUT >	host_link_in;
+static Byte_Queue< HOST_LINK_OUTPUT >		host_link_out;
+
+USART_IO					host_link;
+
+//
+//	The call to initialise it.
+//
+void initialise_host_link( USART_line_speed speed ) {
+	//
+	//	Set up the serial connection.
+	//
+	host_link.initialise( HOST_LINK_DEVICE, speed, CS8, PNone, SBOne, &host_link_in, &host_link_out );
+}
+
+//
+//	Get address of the control gate.
+//
+Signal *host_link_control( void ) {
+	return( host_link_in.control_signal());
+}
+#endif
  
 
 
@@ -41,6 +41,46 @@
 #define CONSOLE_OUTPUT	128
 #endif
 
+//
+//	Optional receive flow control on the console.  Define
+//	CONSOLE_FLOW_CONTROL as FCXonXoff or FCRtsCts (the latter
+//	also requiring CONSOLE_RTS_PIN) to stop the host over
+//	running the input buffer.  The water marks are the
+//	number of bytes in the input buffer at which the host
+//	is stopped and restarted.
+//
+#ifndef CONSOLE_HIGH_WATER
+#define CONSOLE_HIGH_WATER	(CONSOLE_INPUT-8)
+#endif
+#ifndef CONSOLE_LOW_WATER
+#define CONSOLE_LOW_WATER	(CONSOLE_INPUT/4)
+#endif
+#ifndef CONSOLE_RTS_PIN
+#define CONSOLE_RTS_PIN		ERROR_BYTE
+#endif
+
+//
+//	The Host Link
+//	=============
+//
+//	On platforms with more than one USART a second serial
+//	connection is dedicated to machine traffic with the host
+//	computer, leaving the console (the USB connection) for
+//	diagnostics and human readable output.
+//
+//	HOST_LINK_DEVICE is the USART instance used (undefined to
+//	disable the host link).
+//
+#if defined( ARDUINO_AVR_MEGA2560 ) && !defined( HOST_LINK_DEVICE )
+#define HOST_LINK_DEVICE	1
+#endif
+#ifndef HOST_LINK_INPUT
+#define HOST_LINK_INPUT		64
+#endif
+#ifndef HOST_LINK_OUTPUT
+#define HOST_LINK_OUTPUT	128
+#endif
+
 //
 //	The CONSOLE device
 //	==================
@@ -56,6 +96,24 @@ extern void initialise_console( USART_line_speed speed );
 //	Get address of the control gate.
 //
 extern Signal *console_control( void );
+
+#ifdef HOST_LINK_DEVICE
+//
+//	The HOST LINK device
+//	====================
+//
+extern USART_IO		host_link;
+
+//
+//	The call to initialise it.
+//
+extern void initialise_host_link( USART_line_speed speed );
+
+//
+//	Get address of the control gate.
+//
+extern Signal *host_link_control( void );
+#endif
  
 
 #endif
@@ -74,6 +74,9 @@ static const char string_bdt[] PROGMEM = "banner_display_time";
 static const char string_tcr[] PROGMEM = "transient_command_repeats";
 static const char string_smrr[] PROGMEM = "service_mode_reset_repeats";
 static const char string_smcr[] PROGMEM = "service_mode_command_repeats";
+static const char string_ao[] PROGMEM = "adc_oversample";
+static const char string_od[] PROGMEM = "occupancy_debounce";
+static const char string_pus[] PROGMEM = "power_up_spacing";
 
 //
 //	This is the static table of constants support information.
@@ -102,7 +105,11 @@ static const ConstantValue constant_value[ CONSTANTS ] PROGMEM = {
 	{ string_bdt,	DEFAULT_BANNER_DISPLAY_TIME,		NULL,				&BANNER_DISPLAY_TIME			},
 	{ string_tcr,	DEFAULT_TRANSIENT_COMMAND_REPEATS,	NULL,				&TRANSIENT_COMMAND_REPEATS		},
 	{ string_smrr,	DEFAULT_SERVICE_MODE_RESET_REPEATS,	NULL,				&SERVICE_MODE_RESET_REPEATS		},
-	{ string_smcr,	DEFAULT_SERVICE_MODE_COMMAND_REPEATS,	NULL,				&SERVICE_MODE_COMMAND_REPEATS		}
+	{ string_smcr,	DEFAULT_SERVICE_MODE_COMMAND_REPEATS,	NULL,				&SERVICE_MODE_COMMAND_REPEATS		},
+// 20
+	{ string_ao,	DEFAULT_ADC_OVERSAMPLE,			NULL,				&ADC_OVERSAMPLE				},
+	{ string_od,	DEFAULT_OCCUPANCY_DEBOUNCE,		NULL,				&OCCUPANCY_DEBOUNCE			},
+	{ string_pus,	DEFAULT_POWER_UP_SPACING,		&POWER_UP_SPACING,		NULL					}
 };
 
 //
@@ -170,6 +177,10 @@ void reset_constants( void ) {
 			*b = (byte)progmem_read_word( constant_value[ i ].initial );
 		}
 	}
+	//
+	//	Initialise the district table.
+	//
+	memcpy_P( &DISTRICT_TABLE, Districts::default_config, sizeof( district_table ));
 	record_constants();
 }
 
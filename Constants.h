@@ -32,6 +32,7 @@
 #include "Environment.h"
 #include "Menu.h"
 #include "Magic.h"
+#include "Districts.h"
 
 //
 //	The constants will be managed through a two tier system of
@@ -41,7 +42,7 @@
 //
 //	Define the number of constants we have to manage:
 //
-#define CONSTANTS	20
+#define CONSTANTS	23
 
 //
 //	The following structure is the variable space definition
@@ -70,18 +71,26 @@ typedef struct {
 			driver_phase_period,			// 10
 			rotary_scan_period,
 			rotary_update_period,
-			dynamic_load_period;
-	byte		average_current_index,
-			dynamic_load_reports,			// 15
+			dynamic_load_period,
+			power_up_spacing;
+	byte		average_current_index,			// 15
+			dynamic_load_reports,
 			banner_display_time,
 			transient_command_repeats,
 			service_mode_reset_repeats,
-			service_mode_command_repeats;
+			service_mode_command_repeats,		// 20
+			adc_oversample,
+			occupancy_debounce;
 	//
 	//	The following area contains the "Page Memory" managed by
 	//	the user through the menu system.
 	//
 	page_memory	pages;
+	//
+	//	The following area contains the district configuration
+	//	table.
+	//
+	district_table	districts;
 } ConstantValues;
 
 static const int ConstantArea = sizeof( ConstantValues );
@@ -119,7 +128,7 @@ extern Constants constant;
 //	The default value is "built" using the MAGIC() macro
 //	defined in "Magic.h".
 //
-#define DEFAULT_IDENTIFICATION_MAGIC	MAGIC(2024,12,9)
+#define DEFAULT_IDENTIFICATION_MAGIC	MAGIC(2026,10,16)
 #define IDENTIFICATION_MAGIC		constant.var.value.identification_magic
 
 //
@@ -146,6 +155,13 @@ extern Constants constant;
 #define DEFAULT_POWER_GRACE_PERIOD	1000
 #define POWER_GRACE_PERIOD		constant.var.value.power_grace_period
 
+//
+//	The spacing (in milliseconds) between districts being powered
+//	up when a zone is turned on.
+//
+#define DEFAULT_POWER_UP_SPACING	250
+#define POWER_UP_SPACING		constant.var.value.power_up_spacing
+
 //
 //	Define the periodic interval in milliseconds.
 //
@@ -251,11 +267,29 @@ extern Constants constant;
 //
 //	Dynamic Load reports controls if the the Arduino
 //	Generator sends dynamic loading reports to the host
-//	system (the '[L#]' replies).  0 = off, 1 = on.
+//	system (the '[L#]' replies).  0 = off, 1 = ASCII,
+//	2 = binary (see Telemetry.h).
 //
 #define DEFAULT_DYNAMIC_LOAD_REPORTS		0
 #define DYNAMIC_LOAD_REPORTS			constant.var.value.dynamic_load_reports
 
+//
+//	The number of extra bits of resolution obtained by
+//	oversampling the district current readings (0-3).  Each
+//	extra bit takes four times as many ADC conversions to
+//	produce one oversampled reading.
+//
+#define DEFAULT_ADC_OVERSAMPLE			2
+#define ADC_OVERSAMPLE				constant.var.value.adc_oversample
+
+//
+//	The number of consecutive district current readings which
+//	must pass an occupancy threshold before the district changes
+//	between occupied and free.
+//
+#define DEFAULT_OCCUPANCY_DEBOUNCE		20
+#define OCCUPANCY_DEBOUNCE			constant.var.value.occupancy_debounce
+
 //
 //	How long do we display the banner for (on the LCD)
 //
@@ -267,6 +301,12 @@ extern Constants constant;
 //
 #define PAGE_MEMORY				constant.var.value.pages
 
+//
+//	Provide the alias through which the district table can be
+//	accessed.
+//
+#define DISTRICT_TABLE				constant.var.value.districts
+
 
 //
 //	The Constants API
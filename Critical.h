@@ -94,6 +94,28 @@ class Critical {
 };
 
 
+#elif defined( __linux__ )
+
+//
+//	The host build (see host/Makefile).  There are no interrupts
+//	to hold off, as the simulated clock is stepped by a task, so
+//	all code is "normal" code and the block is a no-op.
+//
+class Critical {
+	public:
+		Critical( void ) {}
+		~Critical() {}
+
+	static inline bool critical_code( void ) {
+		return( false );
+	}
+	static inline bool normal_code( void ) {
+		return( true );
+	}
+	static inline void enable_interrupts( void ) {}
+	static inline void disable_interrupts( void ) {}
+};
+
 #else
 
 #error "Define Class Critical for your architecture."
@@ -6,6 +6,7 @@
 //
 
 #include "DCC.h"
+#include "Accessory.h"
 #include "Task.h"
 
 //
@@ -1218,9 +1219,12 @@ bool DCC::mobile_command( word target, byte speed, byte direction ) {
 	buf->reply_when = reply_at_start;
 	
 	//
-	//	Finalise the record and kick it off.
+	//	Finalise the record and kick it off, then note
+	//	the new state of the decoder.
 	//
-	return( complete_buffer( buf ));
+	if( !complete_buffer( buf )) return( false );
+	function_cache.motion( target, speed, direction );
+	return( true );
 }
 
 //
@@ -1282,9 +1286,12 @@ bool DCC::accessory_command( word target, byte state ) {
 	buf->reply_when = reply_at_end;
 
 	//
-	//	Finalise the record and kick it off.
+	//	Finalise the record and kick it off, then note
+	//	the new state of the accessory.
 	//
-	return( complete_buffer( buf ));
+	if( !complete_buffer( buf )) return( false );
+	accessory_cache.update( target, state );
+	return( true );
 }
 
 bool DCC::function_command( word target, byte func, byte state ) {
@@ -1423,9 +1430,15 @@ bool DCC::state_command( word target, byte speed, byte dir, byte fn[ DCC_Constan
 	buf->reply_when = reply_at_start;
 	
 	//
-	//	Finalise the record and kick it off.
+	//	Finalise the record and kick it off, then note
+	//	the new state of the decoder.
 	//
-	return( complete_buffer( buf ));
+	if( !complete_buffer( buf )) return( false );
+	function_cache.motion( target, speed, dir );
+	for( byte f = DCC_Constant::minimum_func_number; f <= DCC_Constant::maximum_func_number; f++ ) {
+		(void)function_cache.update( target, f, ( fn[ f >> 3 ] & ( 1 << ( f & 7 ))) != 0 );
+	}
+	return( true );
 }
 
 //
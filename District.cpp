@@ -13,46 +13,78 @@
 #include "Constants.h"
 #include "Driver.h"
 #include "Task.h"
+#include "Telemetry.h"
+#include "Resync.h"
 
 //
 //	A little math support.
 //
 #include "mul_div.h"
 
-//
-//	Declare the exclusivity gate control.
-//
-Gate District::exclusive_access;
-
 
 //
 //	Initialise the district as unassigned.
 //
 District::District( void ) {
 	_state = state_unassigned;
+	_reverser = NIL( Reverser );
+	_response = 0;
+	_tripped = false;
+	_grace = false;
+	_powered = 0;
+	_weight = 1;
+	_recent = 0;
+	_zero = 0;
+	_full_scale = 0;
+	_number = 0;
+	_occupied_at = 0;
+	_vacant_at = 0;
+	_occupied = false;
+	_debounce = 0;
 }
 
 //
 //	Assign enable and direction pins to this district
 //	(which will then automatically configure the
 //	driver object and initiate use of ADC manager)
+//	as a member of the given reverser group.
 //
-bool District::assign( byte enable, byte direction, byte adc_pin, byte adc_number ) {
-	//
-	//	Set the test pin for input.
-	//
-	_adc.configure( adc_pin, true );
-	_test = adc_number;
+bool District::assign( Reverser *reverser, byte enable, byte direction, byte adc_pin, byte adc_number ) {
 	//
 	//	Add our pins to the driver object.
 	//
 	if( !dcc_driver.add( &_driver, enable, direction )) return( false );
+	return( monitor( reverser, adc_pin, adc_number ));
+}
+
+//
+//	As above, but with the enable and direction pins given
+//	as GPIO device and bit numbers.
+//
+bool District::assign( Reverser *reverser, byte enable_dev, byte enable_bit, byte direction_dev, byte direction_bit, byte adc_pin, byte adc_number ) {
+	if( !dcc_driver.add( &_driver, enable_dev, enable_bit, direction_dev, direction_bit )) return( false );
+	return( monitor( reverser, adc_pin, adc_number ));
+}
+
+//
+//	Join the reverser group, set up the ADC pin and start
+//	monitoring it.
+//
+bool District::monitor( Reverser *reverser, byte adc_pin, byte adc_number ) {
+	ASSERT( reverser != NIL( Reverser ));
+
+	_reverser = reverser;
+	//
+	//	Set the test pin for input.
+	//
+	_adc.configure( adc_pin, true );
 	//
 	//	Add the district to the task manager and
-	//	then initiate the first ADC reading.
+	//	then subscribe to the ADC sequencer.
 	//
 	if( !task_manager.add_task( this, &_flag )) return( false );
-	if( !adc_manager.read( _test, &_flag, &_reading )) return( false );
+	if(( _channel = adc_manager.subscribe( adc_number, &_flag )) == ERROR_BYTE ) return( false );
+	adc_manager.oversample( _channel, ADC_OVERSAMPLE );
 	//
 	//	Done.
 	//
@@ -63,14 +95,63 @@ bool District::assign( byte enable, byte direction, byte adc_pin, byte adc_numbe
 //	Task Entry point from the task manager.
 //
 void District::process( void ) {
+	word	mean;
+	dword	when;
+	bool	tripped,
+		shorted;
+
+	//
+	//	We get here because a ring of readings is available,
+	//	so add the mean of these to the average and keep the
+	//	peak as the reading to test.  During a pause we are
+	//	woken by the timer, and the peak is set to zero.
+	//
+	if( _state == state_paused ) {
+		_reading = 0;
+		mean = 0;
+	}
+	else {
+		adc_manager.collect( _channel, &_reading, &mean );
+	}
+	_average.add( mean );
+
+	//
+	//	Has the ADC ISR already tripped the driver off?  If
+	//	so note how long it has taken us to respond.  Either
+	//	the trip or a high peak reading is a short.
+	//
+	if(( shorted = tripped = adc_manager.tripped( _channel, &when ))) {
+		dword	delay;
+
+		if(( delay = micros() - when ) > MAXIMUM_WORD ) delay = MAXIMUM_WORD;
+		if( delay > _response ) _response = (word)delay;
+	}
+
 	//
-	//	We get here because a reading is available, so
-	//	add this to the average.  There are some cases
-	//	where the "reading" has not been made (during
-	//	a pause), but the reading variable will have been
-	//	reset to zero for this period.
+	//	Within the grace period after power up the capacitors
+	//	in the decoders are charging, so only the (raised) ISR
+	//	trip is acted upon.  At the end of the grace period the
+	//	normal trip is armed.
 	//
-	_average.add( _reading );
+	if( _grace ) {
+		if(( millis() - _powered ) >= POWER_GRACE_PERIOD ) {
+			_grace = false;
+			if( !shorted &&( _state == state_on )) adc_manager.arm( _channel, _driver, INSTANT_CURRENT_LIMIT );
+		}
+	}
+	if( !_grace &&( _reading > INSTANT_CURRENT_LIMIT )) shorted = true;
+
+	//
+	//	Update the statistics, readings only being of interest
+	//	while the driver is powered.
+	//
+	_stats.time( _state );
+	if(( _state == state_on )||( _state == state_shorted )||( _state == state_inverted )) _stats.sample( _reading, INSTANT_CURRENT_LIMIT );
+
+	//
+	//	Occupancy can only be seen while running normally.
+	//
+	if( _state == state_on ) detect();
 	
 	//
 	//	What we do really depends on our state.
@@ -90,7 +171,7 @@ void District::process( void ) {
 			//	district.  We should be testing to
 			//	see how the load is looking.
 			//
-			if( _reading > INSTANT_CURRENT_LIMIT ) {
+			if( shorted ) {
 				//
 				//	This is declared an immediate short, we
 				//	need to head into the recovery process:
@@ -98,14 +179,20 @@ void District::process( void ) {
 				//	head into a power off.  However, the
 				//	"risk" is that multiple districts see the
 				//	same short, we have to ensure only one
-				//	district tries the reverse trick.
+				//	district in our reverser group tries the
+				//	reverse trick.
 				//
-				if( exclusive_access.acquired()) {
+				//	The ISR trip will (almost certainly) have
+				//	turned the driver off, so it is turned back
+				//	on once inverted.
+				//
+				if( _reverser->acquired()) {
 					//
 					//	we have exclusive access to this code
 					//	so jolly well get on with it.
 					//
 					dcc_driver.toggle( _driver );
+					restart();
 					_state = state_inverted;
 				}
 				else {
@@ -114,10 +201,11 @@ void District::process( void ) {
 					//	exclusive access, we transition to shorted
 					//	state to monitor its success.
 					//
+					_tripped = tripped;
 					_state = state_shorted;
 				}
 			}
-			else if( _average.read( average_current_index ) > AVERAGE_CURRENT_LIMIT ) {
+			else if( !_grace &&( _average.read( average_current_index ) > AVERAGE_CURRENT_LIMIT )) {
 				//
 				//	This is an on going overload situation.  This
 				//	is not the result of a short (we believe), so
@@ -141,13 +229,14 @@ void District::process( void ) {
 			//	If still shorted try the exclusive flag one more time before
 			//	heading into a full pause mode.
 			//
-			if( _reading > INSTANT_CURRENT_LIMIT ) {
-				if( exclusive_access.acquired()) {
+			if( shorted ) {
+				if( _reverser->acquired()) {
 					//
 					//	we have exclusive access to this code
 					//	so jolly well get on with it.
 					//
 					dcc_driver.toggle( _driver );
+					restart();
 					_state = state_inverted;
 				}
 				else {
@@ -160,6 +249,16 @@ void District::process( void ) {
 					_state = state_paused;
 				}
 			}
+			else if( _tripped ) {
+				//
+				//	The ISR tripped the driver off, so the quiet
+				//	reading shows nothing.  Power up once more
+				//	(with the trip armed) and see if the short
+				//	is still there on the next ring.
+				//
+				_tripped = false;
+				restart();
+			}
 			else {
 				//
 				//	We're all good now - back to on state.
@@ -176,7 +275,7 @@ void District::process( void ) {
 			//	We are here because we claimed the exclusive lock and
 			//	flipped the phase on this district. 
 			//
-			if( _reading > INSTANT_CURRENT_LIMIT ) {
+			if( shorted ) {
 				//
 				//	There's nothing we can do here - the
 				//	district needs to be turned off.
@@ -192,11 +291,11 @@ void District::process( void ) {
 				_state = state_on;
 			}
 			//
-			//	Final action is to release the exclusive lock
+			//	Final action is to release the reverser group
 			//	before allowing the state variable to control
 			//	next actions.
 			//
-			exclusive_access.release();
+			_reverser->release( _state == state_on );
 			break;
 		}
 		case state_paused: {
@@ -205,8 +304,8 @@ void District::process( void ) {
 			//	a period of time.  Time to restart the district
 			//	and try for normal operation.
 			//
-			dcc_driver.on( _driver );
-			_average.reset();
+			adc_manager.notify( _channel, &_flag );
+			power_up();
 			_state = state_on;
 			break;
 		}
@@ -219,23 +318,115 @@ void District::process( void ) {
 		}
 	}
 	//
-	//	Pausing or reading the ADC - depends on the
-	//	new value state we are in.
+	//	Pausing or continuing with the ADC - depends on
+	//	the new value state we are in.  When pausing, the ADC
+	//	notifications are suspended and any outstanding
+	//	are discarded so only the timer will wake us.
 	//
 	if( _state ==  state_paused ) {
+		vacate();
+		adc_manager.arm( _channel, _driver, 0 );
+		adc_manager.notify( _channel, NIL( Signal ));
+		while( _flag.acquire());
 		time_of_day.add( DRIVER_RESET_PERIOD, &_flag );
 	}
-	else {
-		adc_manager.read( _test, &_flag, &_reading );
+	//
+	//	Finally adjust our share of the ADC conversions.
+	//
+	if( shorted ) _recent = recent_readings;
+	schedule();
+}
+
+//
+//	Set our ADC scheduling weight from how close we are to
+//	the current limits: a district which is near a limit,
+//	has recently been shorted, or is part way through
+//	recovering from a short, is sampled more often, and a
+//	lightly loaded or unpowered district less often.
+//
+void District::schedule( void ) {
+	word	average;
+	byte	w;
+
+	average = _average.read( average_current_index );
+	switch( _state ) {
+		case state_on: {
+			if( _recent ) {
+				_recent--;
+				w = ADC_Manager::maximum_weight;
+			}
+			else if( _grace ||( _reading >= ( INSTANT_CURRENT_LIMIT >> 1 ))||( average >= AVERAGE_CURRENT_LIMIT - ( AVERAGE_CURRENT_LIMIT >> 2 ))) {
+				w = ADC_Manager::maximum_weight;
+			}
+			else if( average >= ( AVERAGE_CURRENT_LIMIT >> 1 )) {
+				w = ADC_Manager::maximum_weight >> 1;
+			}
+			else if( average >= ( AVERAGE_CURRENT_LIMIT >> 2 )) {
+				w = 2;
+			}
+			else {
+				w = 1;
+			}
+			break;
+		}
+		case state_shorted:
+		case state_inverted: {
+			w = ADC_Manager::maximum_weight;
+			break;
+		}
+		default: {
+			w = 1;
+			break;
+		}
 	}
+	if( w != _weight ) adc_manager.weight( _channel, ( _weight = w ));
 }
 
 //
 //	Control the power on this district.
 //
 void District::power( bool on ) {
-	dcc_driver.power( _driver, on );
-	_state = on? state_on: state_off;
+	//
+	//	Do not leave the reverser group locked if we are
+	//	part way through a polarity flip.
+	//
+	if( _state == state_inverted ) _reverser->release( false );
+	_stats.time( _state );
+	if( on ) {
+		adc_manager.notify( _channel, &_flag );
+		power_up();
+		_state = state_on;
+	}
+	else {
+		adc_manager.arm( _channel, _driver, 0 );
+		dcc_driver.off( _driver );
+		vacate();
+		_state = state_off;
+	}
+}
+
+//
+//	Power up the driver and arm the ADC trip.
+//
+void District::restart( void ) {
+	_grace = false;
+	dcc_driver.on( _driver );
+	adc_manager.arm( _channel, _driver, INSTANT_CURRENT_LIMIT );
+}
+
+//
+//	Power up the driver from cold, starting the grace period.
+//
+void District::power_up( void ) {
+	_average.reset();
+	_grace = true;
+	_powered = millis();
+	dcc_driver.on( _driver );
+	adc_manager.arm( _channel, _driver, grace_trip_limit );
+	//
+	//	The decoders on the district have lost their state.
+	//
+	resync.start();
 }
 
 //
@@ -245,6 +436,111 @@ byte District::load_average( void ) {
 	return( (byte)mul_div<word>( _average.read( AVERAGE_CURRENT_INDEX ), 100, AVERAGE_CURRENT_LIMIT ));
 }
 
+//
+//	Return the most recent raw ADC reading and the
+//	compounded average at the given index.
+//
+word District::reading( void ) {
+	return( _reading );
+}
+
+word District::average( byte index ) {
+	return( _average.read( index ));
+}
+
+//
+//	Return the number of ISR trips and the longest time (in
+//	microseconds) taken to respond to one.
+//
+word District::trips( void ) {
+	return( adc_manager.trips( _channel ));
+}
+
+word District::response( void ) {
+	return( _response );
+}
+
+//
+//	Set the current calibration.
+//
+void District::calibrate( byte zero, word full_scale ) {
+	_zero = zero;
+	_full_scale = full_scale;
+}
+
+//
+//	Return the current (in milliamps) calculated from the
+//	oversampled reading.  The zero point is given at 10 bit
+//	resolution, so is scaled up to match the reading.
+//
+word District::milliamps( void ) {
+	word	f, z;
+	byte	b;
+
+	f = adc_manager.fine( _channel );
+	b = adc_manager.resolution( _channel );
+	z = (word)_zero << ( b - 10 );
+	if( f <= z ) return( 0 );
+	return( (word)((( dword )( f - z ) * _full_scale ) >> b ));
+}
+
+//
+//	Set up the occupancy detection.
+//
+void District::detection( byte number, word occupied, word vacant ) {
+	_number = number;
+	_occupied_at = occupied;
+	_vacant_at = vacant;
+	_occupied = false;
+	_debounce = 0;
+}
+
+//
+//	Update the occupancy detection with the latest reading.  The
+//	state only changes once OCCUPANCY_DEBOUNCE consecutive
+//	readings have passed the relevant threshold.
+//
+void District::detect( void ) {
+	word	ma;
+	bool	change;
+
+	if( _occupied_at == 0 ) return;
+	ma = milliamps();
+	change = _occupied? ( ma <= _vacant_at ): ( ma >= _occupied_at );
+	if( !change ) {
+		_debounce = 0;
+		return;
+	}
+	if( ++_debounce < OCCUPANCY_DEBOUNCE ) return;
+	_debounce = 0;
+	_occupied = !_occupied;
+	telemetry.occupancy( _number, _occupied );
+}
+
+//
+//	Drop the occupancy when the district loses power.
+//
+void District::vacate( void ) {
+	_debounce = 0;
+	if( !_occupied ) return;
+	_occupied = false;
+	telemetry.occupancy( _number, false );
+}
+
+//
+//	Return the occupancy state detected.
+//
+bool District::occupied( void ) {
+	return( _occupied );
+}
+
+//
+//	Return access to the district statistics.
+//
+District::statistics_block *District::statistics( void ) {
+	return( &_stats );
+}
+
 //
 //	Return the state of this district
 //
@@ -18,8 +18,9 @@
 
 #include "Task_Entry.h"
 #include "Average.h"
+#include "Load_Stats.h"
 #include "Pin_IO.h"
-#include "Gate.h"
+#include "Reverser.h"
 #include "Signal.h"
 
 //
@@ -61,6 +62,19 @@ public:
 	//
 	static const byte	short_average_value = 2;
 
+	//
+	//	Define the reading which will trip the driver during the
+	//	power up grace period, when the normal limits are not
+	//	applied.  This is close to a saturated ADC; a dead short.
+	//
+	static const word	grace_trip_limit = 1000;
+
+	//
+	//	Define the number of readings after a short during which
+	//	the district keeps the highest ADC scheduling weight.
+	//
+	static const byte	recent_readings = 200;
+
 	//
 	//	Declare the set of states in which a district can be
 	//	sitting in.
@@ -77,6 +91,16 @@ public:
 		state_paused		// ...	is down as result of short
 					//	or overload.
 	};
+
+	//
+	//	The number of states above.
+	//
+	static const byte	district_states = state_paused + 1;
+
+	//
+	//	The statistics kept for a district.
+	//
+	typedef Load_Stats< district_states >	statistics_block;
 	
 private:
 	//
@@ -92,29 +116,115 @@ private:
 
 	//
 	//	Keep a copy of the ADC pin we need to check for the
-	//	power monitoring facility.
+	//	power monitoring facility, and the handle of the
+	//	ADC sequencer channel reading it.
 	//
 	Pin_IO				_adc;
-	byte				_test;
+	byte				_channel;
 
 	//
-	//	The control area from the ADC manager.
+	//	The control area from the ADC manager, the reading
+	//	being the peak of the most recent ring of samples.
 	//
 	word				_reading;
 	Signal				_flag;
 
+	//
+	//	The longest time (microseconds) between the ADC ISR
+	//	tripping the driver off and this task responding.
+	//
+	word				_response;
+
+	//
+	//	Set while in state_shorted with the driver tripped off
+	//	by the ADC ISR, when a quiet reading says nothing about
+	//	whether the short is still there.
+	//
+	bool				_tripped;
+
+	//
+	//	Set while in the grace period after powering up, and
+	//	when (in milliseconds) the power was applied.
+	//
+	bool				_grace;
+	dword				_powered;
+
+	//
+	//	The ADC scheduling weight in use, and the number of
+	//	readings still to be taken at the highest weight after
+	//	a short.
+	//
+	byte				_weight,
+					_recent;
+
 	//
 	//	Where we gather our readings over time.
 	//
 	Average<compounded_values>	_average;
 
 	//
-	//	Declare a single Gateway, common to all defined
-	//	Districts, that controls access to code which
-	//	only a single district should execute at any
-	//	single time.
+	//	The statistics of the load on this district.
+	//
+	statistics_block		_stats;
+
+	//
+	//	The current calibration: ADC reading at zero current and
+	//	the milliamps represented by a full scale reading.
+	//
+	byte				_zero;
+	word				_full_scale;
+
+	//
+	//	Occupancy detection: our district number (for the
+	//	reports), the thresholds (milliamps), the detected state
+	//	and the count of consecutive readings indicating that
+	//	the state has changed.
+	//
+	byte				_number;
+	word				_occupied_at,
+					_vacant_at;
+	bool				_occupied;
+	byte				_debounce;
+
+	//
+	//	The reverser group this district belongs to, which
+	//	controls access to the polarity flip so that only a
+	//	single district of the group tries it at any one time.
 	//
-	static Gate			exclusive_access;
+	Reverser			*_reverser;
+
+	//
+	//	Join the reverser group, set up the ADC pin and start
+	//	monitoring it.
+	//
+	bool monitor( Reverser *reverser, byte adc_pin, byte adc_number );
+
+	//
+	//	Update the occupancy detection with the latest reading.
+	//
+	void detect( void );
+
+	//
+	//	Drop the occupancy when the district loses power, as
+	//	it can no longer be seen.
+	//
+	void vacate( void );
+
+	//
+	//	Power up the driver and arm the ADC trip.
+	//
+	void restart( void );
+
+	//
+	//	Power up the driver from cold, starting the grace period.
+	//
+	void power_up( void );
+
+	//
+	//	Set our ADC scheduling weight from how close we are to
+	//	the current limits.
+	//
+	void schedule( void );
 
 public:
 	//
@@ -126,8 +236,10 @@ public:
 	//	Assign enable and direction pins to this district
 	//	(which will then automatically configure the
 	//	driver object and initiate use of ADC manager)
+	//	as a member of the given reverser group.
 	//
-	bool assign( byte enable, byte direction, byte adc_pin, byte adc_number );
+	bool assign( Reverser *reverser, byte enable, byte direction, byte adc_pin, byte adc_number );
+	bool assign( Reverser *reverser, byte enable_dev, byte enable_bit, byte direction_dev, byte direction_bit, byte adc_pin, byte adc_number );
 
 	//
 	//	Task Entry point from the task manager.
@@ -144,6 +256,39 @@ public:
 	//
 	byte load_average( void );
 
+	//
+	//	Return the most recent raw ADC reading and the
+	//	compounded average at the given index.
+	//
+	word reading( void );
+	word average( byte index );
+
+	//
+	//	Return the number of ISR trips and the longest time (in
+	//	microseconds) taken to respond to one.
+	//
+	word trips( void );
+	word response( void );
+
+	//
+	//	Return access to the district statistics.
+	//
+	statistics_block *statistics( void );
+
+	//
+	//	Set the current calibration, and return the current
+	//	(in milliamps) calculated from the oversampled reading.
+	//
+	void calibrate( byte zero, word full_scale );
+	word milliamps( void );
+
+	//
+	//	Set up the occupancy detection, and return the state
+	//	detected.
+	//
+	void detection( byte number, word occupied, word vacant );
+	bool occupied( void );
+
 	//
 	//	Return the state of this district
 	//
@@ -7,6 +7,11 @@
 
 
 #include "Districts.h"
+#include "ADC_Manager.h"
+#include "Constants.h"
+#include "Errors.h"
+#include "Task.h"
+#include "Clock.h"
 
 //
 //	Current configured for a basic Arduino Motor Shield
@@ -47,21 +52,46 @@
 #define SHIELD_DRIVER_B_LOAD		A1
 #define SHIELD_DRIVER_B_ANALOGUE	1
 
+#define SHIELD_DRIVER_ZERO		0
+#define SHIELD_DRIVER_FULL_SCALE	3030
+#define SHIELD_DRIVER_OCCUPIED		15
+#define SHIELD_DRIVER_VACANT		8
 
-const Districts::district_data Districts::_district_data[ Districts::districts ] PROGMEM = {
+
+//
+//	The default table has the two motor shield drivers, both
+//	in zone 1.  Further boosters can be added (up to
+//	MAXIMUM_DISTRICTS) using either platform pin numbers
+//	(DISTRICT_PINS) or GPIO device and bit numbers
+//	(DISTRICT_PORTS) for the enable and direction signals,
+//	ERROR_BYTE indicating no brake pin.
+//
+//	The motor shield current sense gives 1.65 volts per amp,
+//	so a full scale reading (5 volts) is a little over 3 amps.
+//	The occupancy thresholds are set for a single idling
+//	decoder.
+//
+const district_config Districts::default_config[ Districts::maximum_districts ] PROGMEM = {
 	//
-	//	enable			direction			adc_pin			adc_test			brake
-	//	------			---------			-------			--------			-----
+	//	type		enable			bit	direction			bit	adc_pin			adc_test			brake			zones		group	zero			full_scale			occupied		vacant
+	//	----		------			---	---------			---	-------			--------			-----			-----		-----	----			----------			--------		------
+	//
+	{	DISTRICT_PINS,	SHIELD_DRIVER_A_ENABLE,	0,	SHIELD_DRIVER_A_DIRECTION,	0,	SHIELD_DRIVER_A_LOAD,	SHIELD_DRIVER_A_ANALOGUE,	SHIELD_DRIVER_A_BRAKE,	bit( 1 ),	0,	SHIELD_DRIVER_ZERO,	SHIELD_DRIVER_FULL_SCALE,	SHIELD_DRIVER_OCCUPIED,	SHIELD_DRIVER_VACANT	},
+	{	DISTRICT_PINS,	SHIELD_DRIVER_B_ENABLE,	0,	SHIELD_DRIVER_B_DIRECTION,	0,	SHIELD_DRIVER_B_LOAD,	SHIELD_DRIVER_B_ANALOGUE,	SHIELD_DRIVER_B_BRAKE,	bit( 1 ),	0,	SHIELD_DRIVER_ZERO,	SHIELD_DRIVER_FULL_SCALE,	SHIELD_DRIVER_OCCUPIED,	SHIELD_DRIVER_VACANT	}
+	//
+	//	Remaining entries are DISTRICT_UNUSED.
 	//
-	{	SHIELD_DRIVER_A_ENABLE,	SHIELD_DRIVER_A_DIRECTION,	SHIELD_DRIVER_A_LOAD,	SHIELD_DRIVER_A_ANALOGUE,	SHIELD_DRIVER_A_BRAKE,	1	},
-	{	SHIELD_DRIVER_B_ENABLE,	SHIELD_DRIVER_B_DIRECTION,	SHIELD_DRIVER_B_LOAD,	SHIELD_DRIVER_B_ANALOGUE,	SHIELD_DRIVER_B_BRAKE,	1	}
 };
 
 //
 //	Allow this to build itself empty first.
 //
 Districts::Districts( void ) {
+	_districts = 0;
+	_groups = 0;
 	_zone = 0;
+	_pending = 0;
+	_scheduled = false;
 }
 
 //
@@ -69,30 +99,71 @@ Districts::Districts( void ) {
 //
 void Districts::initialise( void ) {
 	//
-	//	Set up the districts according to the built in
-	//	table.
+	//	Set up the districts according to the table held
+	//	in the constants.  The table is read in order and
+	//	stops at the first unused entry.
 	//
-	for( byte i = 0; i < districts; i++ ) {
-		const district_data	*d;
-		Pin_IO			brake;
+	_districts = 0;
+	_groups = 0;
+	for( byte i = 0; i < maximum_districts; i++ ) {
+		district_config	*d;
+		Pin_IO		brake;
+		bool		ok;
 
-		d = &( _district_data[ i ]);
+		d = &( DISTRICT_TABLE.district[ i ]);
+		if( d->type == DISTRICT_UNUSED ) break;
+		if( d->group >= maximum_districts ) {
+			errors.log_error( DISTRICT_CONFIG_INVALID, i );
+			break;
+		}
 		
-		brake.configure( progmem_read_byte( d->brake ), false );
-		brake.low();
-		
-		_district[ i ].assign(	progmem_read_byte( d->enable ),
-					progmem_read_byte( d->direction ),
-					progmem_read_byte( d->adc_pin ),
-					progmem_read_byte( d->adc_test ));
+		if( d->brake != ERROR_BYTE ) {
+			brake.configure( d->brake, false );
+			brake.low();
+		}
+		if( d->type == DISTRICT_PORTS ) {
+			ok = _district[ _districts ].assign(	&( _reverser[ d->group ]),
+								d->enable, d->enable_bit,
+								d->direction, d->direction_bit,
+								d->adc_pin, d->adc_test );
+		}
+		else {
+			ok = _district[ _districts ].assign(	&( _reverser[ d->group ]),
+								d->enable,
+								d->direction,
+								d->adc_pin, d->adc_test );
+		}
+		if( !ok ) {
+			errors.log_error( DISTRICT_CONFIG_INVALID, i );
+			break;
+		}
+		_district[ _districts ].calibrate( d->zero, d->full_scale );
+		_district[ _districts ].detection( _districts, d->occupied, d->vacant );
+		_groups |= bit( d->group );
+		_zones[ _districts++ ] = d->zones;
 	}
 	//
+	//	With all the districts subscribed, set the ADC
+	//	sequencer running.
+	//
+	adc_manager.start();
+	//
 	//	Ensure everything is off.
 	//
-	for( byte i = 0; i < districts; _district[ i++ ].power( false ));
+	for( byte i = 0; i < _districts; _district[ i++ ].power( false ));
 	_zone = 0;
+	//
+	//	Link in the power up sequencer.
+	//
+	task_manager.add_task( this, &_flag );
 }
 
+//
+//	Return the number of districts configured.
+//
+byte Districts::count( void ) {
+	return( _districts );
+}
 
 //
 //	Return the number of the zone currently being operated.
@@ -108,22 +179,145 @@ byte Districts::zone( void ) {
 //
 void Districts::power( byte zone ) {
 	_zone = zone;
-	for( byte i = 0; i < districts; i++ ) _district[ i ].power( progmem_read_byte( _district_data[ i ].zone ) == zone );
+	_pending = 0;
+	for( byte i = 0; i < _districts; i++ ) {
+		if( _zones[ i ] & bit( zone )) {
+			//
+			//	Only districts which are off need to be
+			//	powered up.
+			//
+			if( _district[ i ].state() == District::state_off ) _pending |= bit( i );
+		}
+		else {
+			_district[ i ].power( false );
+		}
+	}
+	//
+	//	Start the sequence now, unless the sequencer is already
+	//	scheduled (in which case it will pick these up when the
+	//	spacing period after the last district has passed).
+	//
+	if( _pending && !_scheduled ) {
+		_scheduled = true;
+		_flag.release();
+	}
+}
+
+//
+//	The power up sequencer task entry point.
+//
+void Districts::process( void ) {
+	word	spacing;
+
+	//
+	//	This is the one outstanding release (or timer) firing.
+	//
+	_scheduled = false;
+	if( _pending == 0 ) return;
+	for( byte i = 0; i < _districts; i++ ) {
+		if( _pending & bit( i )) {
+			_pending &= ~bit( i );
+			_district[ i ].power( true );
+			break;
+		}
+	}
+	//
+	//	Nothing else is powered until the spacing period has
+	//	passed, even if the next district is only asked for
+	//	after this one.
+	//
+	_scheduled = true;
+	if(( spacing = POWER_UP_SPACING ) > maximum_spacing ) spacing = maximum_spacing;
+	if( !event_timer.delay_event( MSECS( spacing ), &_flag, false )) {
+		errors.log_error( EVENT_TIMER_QUEUE_FULL, spacing );
+		_flag.release();
+	}
+}
+
+//
+//	Return true while the power up sequence is under way.
+//
+bool Districts::powering( void ) {
+	return( _pending != 0 );
 }
 
 //
 //	Return current load average (0-100) for indicated district
 //
 byte Districts::load_average( byte index ) {
-	if( index >= districts ) return( 0 );
+	if( index >= _districts ) return( 0 );
 	return( _district[ index ].load_average());
 }
 
+//
+//	Return the raw reading and a compounded average
+//	for the indicated district.
+//
+word Districts::reading( byte index ) {
+	if( index >= _districts ) return( 0 );
+	return( _district[ index ].reading());
+}
+
+word Districts::average( byte index, byte span ) {
+	if( index >= _districts ) return( 0 );
+	return( _district[ index ].average( span ));
+}
+
+//
+//	Return the ISR trip count and worst trip response
+//	time for the indicated district.
+//
+word Districts::trips( byte index ) {
+	if( index >= _districts ) return( 0 );
+	return( _district[ index ].trips());
+}
+
+word Districts::response( byte index ) {
+	if( index >= _districts ) return( 0 );
+	return( _district[ index ].response());
+}
+
+//
+//	Return the statistics for the indicated district.
+//
+District::statistics_block *Districts::statistics( byte index ) {
+	if( index >= _districts ) return( NIL( District::statistics_block ));
+	return( _district[ index ].statistics());
+}
+
+//
+//	Return the calibrated current drawn by the indicated
+//	district.
+//
+word Districts::milliamps( byte index ) {
+	if( index >= _districts ) return( 0 );
+	return( _district[ index ].milliamps());
+}
+
+//
+//	Return a bit map of the districts currently occupied.
+//
+byte Districts::occupancy( void ) {
+	byte	m;
+
+	m = 0;
+	for( byte i = 0; i < _districts; i++ ) if( _district[ i ].occupied()) m |= bit( i );
+	return( m );
+}
+
+//
+//	Return the indicated reverser group.
+//
+Reverser *Districts::reverser( byte group ) {
+	if(( group >= maximum_districts )||!( _groups & bit( group ))) return( NIL( Reverser ));
+	return( &( _reverser[ group ]));
+}
+
 //
 //	Return the state of this district
 //
 District::district_state Districts::state( byte index ) {
-	if( index >= districts ) return( District::state_unassigned );
+	if( index >= _districts ) return( District::state_unassigned );
 	return( _district[ index ].state());
 }
 
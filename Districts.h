@@ -15,22 +15,79 @@
 #include "Configuration.h"
 #include "Environment.h"
 #include "District.h"
+#include "Driver.h"
+#include "Task_Entry.h"
+#include "Signal.h"
 
 //
-//	JEFF
+//	The configuration of each district is held in the constants
+//	(and so in EEPROM) using the following record.  The driver
+//	pins are given either as platform pin numbers or as a GPIO
+//	device and bit number, as indicated by the type.
 //
-//		Probably need to consider the creation of "zones" within the
-//		districts - specifically "Main Track" and "Programming Track"
+//	The zones are a bit map of the power zones the district is
+//	part of (bit n for zone n).  Zone 0 is "all off", so bit 0
+//	should never be set.
 //
+//	The group is the auto-reverser group (0 to MAXIMUM_DISTRICTS-1)
+//	of the district.  Districts which can short against each other
+//	(the two sides of a reversing loop) must share a group;
+//	independent loops should be given separate groups so their
+//	shorts can be resolved concurrently.
+//
+//	The current calibration of the district is given by the
+//	ADC reading at zero current (zero) and the current, in
+//	milliamps, which would give a full scale ADC reading
+//	(full_scale).
+//
+//	The district is declared occupied when the current drawn
+//	rises to the occupied threshold, and free again when it falls
+//	to the vacant threshold (both in milliamps).  An occupied
+//	threshold of zero disables detection for the district.
+//
+#define DISTRICT_UNUSED		0
+#define DISTRICT_PINS		1
+#define DISTRICT_PORTS		2
+
+struct district_config {
+	byte	type,
+		enable,
+		enable_bit,
+		direction,
+		direction_bit,
+		adc_pin,
+		adc_test,
+		brake,
+		zones,
+		group,
+		zero;
+	word	full_scale,
+		occupied,
+		vacant;
+};
+
+//
+//	This is the table which forms part of the constants data
+//	that is restored from EEPROM when the firmware begins.
+//
+struct district_table {
+	district_config	district[ MAXIMUM_DISTRICTS ];
+};
 
 //
 //	Define the object holding all of the districts and providing
 //	the "high level" access and control of the districts.
 //
-class Districts {
+//	Powering up a zone is sequenced: the districts are powered
+//	one at a time, POWER_UP_SPACING milliseconds apart, so the
+//	inrush current of one district is over (and inside its
+//	grace period) before the next starts.
+//
+class Districts : public Task_Entry {
 public:
 	//
-	//	Define the number of districts which we are going to handle.
+	//	Define the maximum number of districts which we are going
+	//	to handle.
 	//
 	//	This number here is really limited by the number of ADC lines which
 	//	the MCU has available.  On Arduino UNO/Nano this is typically 6
@@ -39,36 +96,57 @@ public:
 	//	That being said, this is also limited by the number of H-Bridge
 	//	driver devices which can be attached to the MCU.  With the
 	//	standard "Arduino Motor Driver Shield" This is actually a
-	//	much lower number; 2.
+	//	much lower number; 2, which is the default configuration.
+	//
+	static const byte	maximum_districts = MAXIMUM_DISTRICTS;
+
+	//
+	//	The default district configuration, copied into the
+	//	constants when they are reset.
 	//
-	static const byte	districts = 2;
+	static const district_config default_config[ maximum_districts ] PROGMEM;
+
+	//
+	//	The longest spacing (in milliseconds) between districts
+	//	powering up which the event timer can support.
+	//
+	static const word	maximum_spacing = 3000;
 	
 private:
 	//
-	//	Declare the set of districts which we will be managing.
+	//	Declare the set of districts which we will be managing,
+	//	and how many have been configured.
+	//
+	District	_district[ maximum_districts ];
+	byte		_districts;
+
+	//
+	//	The zone bit map of each district.
 	//
-	District	_district[ districts ];
+	byte		_zones[ maximum_districts ];
 
 	//
-	//	Declare the data structure that provides the input data
-	//	to facilitate the configuration of the individual
-	//	districts.
+	//	The reverser groups, and a bit map of the groups which
+	//	have districts in them.
 	//
-	struct district_data {
-		byte	enable,
-			direction,
-			adc_pin,
-			adc_test,
-			brake,
-			zone;
-	};
-	static const district_data _district_data[ districts ] PROGMEM;
+	Reverser	_reverser[ maximum_districts ];
+	byte		_groups;
 
 	//
 	//	Which zone is powered on.
 	//
 	byte		_zone;
 
+	//
+	//	The power up sequencer: the districts still to be
+	//	powered up, and if the sequencer task has been
+	//	scheduled (released, or a spacing timer is running).
+	//	Only one release is ever outstanding.
+	//
+	byte		_pending;
+	bool		_scheduled;
+	Signal		_flag;
+
 public:
 	//
 	//	Allow this to build itself empty first.
@@ -80,21 +158,75 @@ public:
 	//
 	void initialise( void );
 
+	//
+	//	Return the number of districts configured.
+	//
+	byte count( void );
+
 	//
 	//	Return the number of the zone currently being operated.
 	//
 	byte zone( void );
 
 	//
-	//	Set the power on for the districts "in zone".
+	//	Set the power on for the districts "in zone" (and off for
+	//	all others).  Districts are turned off immediately, but
+	//	powered up in sequence.
 	//
 	void power( byte zone );
 
+	//
+	//	The power up sequencer task entry point.
+	//
+	virtual void process( void );
+
+	//
+	//	Return true while the power up sequence is under way.
+	//
+	bool powering( void );
+
 	//
 	//	Return current load average (0-100) for indicated district
 	//
 	byte load_average( byte index );
 
+	//
+	//	Return the raw reading and a compounded average
+	//	for the indicated district.
+	//
+	word reading( byte index );
+	word average( byte index, byte span );
+
+	//
+	//	Return the ISR trip count and worst trip response
+	//	time (microseconds) for the indicated district.
+	//
+	word trips( byte index );
+	word response( byte index );
+
+	//
+	//	Return the indicated reverser group, or NIL if
+	//	there is no such group (or it has no districts).
+	//
+	Reverser *reverser( byte group );
+
+	//
+	//	Return the statistics for the indicated district, or
+	//	NIL if there is no such district.
+	//
+	District::statistics_block *statistics( byte index );
+
+	//
+	//	Return the calibrated current (milliamps) drawn by
+	//	the indicated district.
+	//
+	word milliamps( byte index );
+
+	//
+	//	Return a bit map of the districts currently occupied.
+	//
+	byte occupancy( void );
+
 	//
 	//	Return the state of this district
 	//
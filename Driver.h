@@ -15,12 +15,15 @@
 #include "Configuration.h"
 #include "Environment.h"
 #include "Pin_IO.h"
+#include "Critical.h"
 
 //
 //	Set the maximum number of districts we want to be able to handle.
+//	The small MCUs only have room for (and only ever drive) the two
+//	districts of the motor shield.
 //
 #ifndef MAXIMUM_DISTRICTS
-#define MAXIMUM_DISTRICTS	8
+#define MAXIMUM_DISTRICTS	SELECT_SML(2,8,8)
 #endif
 
 //
@@ -128,14 +131,24 @@ public:
 	//
 	//	Now the DCC generator will use the following API calls.
 	//
+	//	Note:	The pins are changed inside critical code
+	//		as the ADC manager can turn a driver off from
+	//		inside its ISR, and that change must not be lost
+	//		in the middle of a read/modify/write of the same
+	//		port.
+	//
 	
 	//
 	//	Turn on all or one district
 	//
 	void on( void ) {
+		Critical	code;
+
 		for( byte i = 0; i < _districts; _district[ i++ ].enable.high());
 	}
 	void on( byte index ) {
+		Critical	code;
+
 		if( index < _districts ) _district[ index ].enable.high();
 	}
 
@@ -143,9 +156,13 @@ public:
 	//	Turn off all or one district
 	//
 	void off( void ) {
+		Critical	code;
+
 		for( byte i = 0; i < _districts; _district[ i++ ].enable.low());
 	}
 	void off( byte index ) {
+		Critical	code;
+
 		if( index < _districts ) _district[ index ].enable.low();
 	}
 
@@ -153,9 +170,13 @@ public:
 	//	Toggle the output signal of all or a single district.
 	//
 	void toggle( void ) {
+		Critical	code;
+
 		for( byte i = 0; i < _districts; _district[ i++ ].direction.toggle());
 	}
 	void toggle( byte index ) {
+		Critical	code;
+
 		if( index < _districts ) _district[ index ].direction.toggle();
 	}
 
@@ -163,9 +184,13 @@ public:
 	//	Generic power on/off call.
 	//
 	void power( bool on ) {
+		Critical	code;
+
 		for( byte i = 0; i < _districts; _district[ i++ ].enable.set( on ));
 	}
 	void power( byte index, bool on ) {
+		Critical	code;
+
 		if( index < _districts ) _district[ index ].enable.set( on );
 	}
 };
@@ -313,6 +313,8 @@ typedef enum {
 #define PLUS		'+'
 #define USCORE		'_'
 #define DELETE		'\177'
+#define XON		'\021'
+#define XOFF		'\023'
 #define ERROR		(-1)
 
 
@@ -13,6 +13,7 @@
 #include "Task.h"
 #include "Clock.h"
 #include "Code_Assurance.h"
+#include "Critical.h"
 #include "Buffer.h"
 #include "DCC.h"
 #include "Protocol.h"
@@ -52,6 +53,7 @@ Errors::Errors( void ) {
 	_count = 0;
 	_in = 0;
 	_out = 0;
+	_logged = 0;
 }
 
 //
@@ -111,6 +113,17 @@ void Errors::process( void ) {
 void Errors::log_error( byte error, word arg ) {
 	byte	i, j;
 
+	//
+	//	Count every error, reported or not.  Errors are
+	//	logged from interrupt handlers as well as tasks, so
+	//	the count is only updated with interrupts held off.
+	//
+	{
+		Critical	code;
+
+		if( _logged < MAXIMUM_WORD ) _logged++;
+	}
+
 	//
 	//	Has this error been reported before?
 	//
@@ -261,6 +274,14 @@ void Errors::log_terminate( word error, const char *file_name, word line_number
 	//
 }
 
+//
+//	Return the total number of errors logged.
+//
+word Errors::logged( void ) {
+	Critical code;
+
+	return( _logged );
+}
 
 
 //
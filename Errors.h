@@ -65,6 +65,7 @@
 #define POWER_OVERLOAD			42
 #define POWER_SPIKE			43
 #define PROGRAMMING_TRACK_ONLY		44
+#define DISTRICT_CONFIG_INVALID		45
 
 //
 //	System processing errors.
@@ -79,6 +80,7 @@
 //	Process reporting errors
 //
 #define COMMAND_REPORT_FAIL		60
+#define QUERY_IN_PROGRESS		61
 
 //
 //	Errors relating to the (now missing)
@@ -169,6 +171,11 @@ private:
 	byte		_count,
 			_in,
 			_out;
+
+	//
+	//	Total number of errors logged.
+	//
+	word		_logged;
 			
 	//
 	//	The task conrtol signal.
@@ -208,6 +215,11 @@ public:
 	//	Log a terminal system error with the system.
 	//
 	void log_terminate( word error, const char *file_name, word line_number );
+
+	//
+	//	Return the total number of errors logged.
+	//
+	word logged( void );
 };
 
 
@@ -26,7 +26,10 @@ FrameBuffer::FrameBuffer( void ) {
 	_chk_r = 0;
 	_chk_c = 0;
 	_cursor = 0;
-	_sync = false;
+	_address = unknown_address;
+	_dirty = 0;
+	_idle = false;
+	_resets = 0;
 }
 
 void FrameBuffer::initialise( LCD *lcd, byte *buffer, byte size, byte rows, byte cols ) {
@@ -52,6 +55,8 @@ void FrameBuffer::initialise( LCD *lcd, byte *buffer, byte size, byte rows, byte
 	//	needing to be updated.
 	//
 	for( byte i = 0; i < _size; _buffer[ i++ ] = TAG_DIRTY( SPACE ));
+	_dirty = _size;
+	_resets = _lcd->resets();
 
 	//
 	//	Add ourselves to the task list.
@@ -65,16 +70,29 @@ void FrameBuffer::initialise( LCD *lcd, byte *buffer, byte size, byte rows, byte
 	_flag.release();
 }
 
+//
+//	Restart the refresh process if it has stopped because
+//	there was nothing to do.
+//
+void FrameBuffer::wake( void ) {
+	if( _idle ) {
+		_idle = false;
+		_flag.release();
+	}
+}
+
 void FrameBuffer::clear( void ) {
 	//
 	//	Empty the buffer and tag data as
 	//	needing to be updated.
 	//
 	for( byte i = 0; i < _size; _buffer[ i++ ] = TAG_DIRTY( SPACE ));
+	_dirty = _size;
 	//
 	//	Set cursor to home.
 	//
 	_cursor = 0;
+	wake();
 }
 
 	
@@ -108,7 +126,13 @@ void FrameBuffer::write_char( char val ) {
 	//	Place value into the frame buffer but only if
 	//	it is different from the value already there.
 	//
-	if( _buffer[ _cursor ] != v ) _buffer[ _cursor ] = TAG_DIRTY( v );
+	if( _buffer[ _cursor ] != v ) {
+		if( !IS_DIRTY( _buffer[ _cursor ])) {
+			_dirty++;
+			wake();
+		}
+		_buffer[ _cursor ] = TAG_DIRTY( v );
+	}
 	//
 	//	Move the cursor forward, and wrap to the top
 	//	if we fall off the bottom.
@@ -135,124 +159,183 @@ void FrameBuffer::fill( char val, byte len ) {
 }
 
 
+//
+//	Move a scan position on to the next cell, in the order the
+//	cells sit in the LCD display memory.  On a four line display
+//	this takes the rows in the order 0, 2, 1, 3 so that (on a
+//	20 column display) a complete pass is a single run of
+//	addresses which the LCD steps through by itself.
+//
+void FrameBuffer::step( byte *r, byte *c ) {
+	if(( *c += 1 ) >= _cols ) {
+		*c = 0;
+		if( _rows == 4 ) {
+			switch( *r ) {
+				case 0: *r = 2; break;
+				case 2: *r = 1; break;
+				case 1: *r = 3; break;
+				default: *r = 0; break;
+			}
+		}
+		else {
+			if(( *r += 1 ) >= _rows ) *r = 0;
+		}
+	}
+}
+
 //
 //	The procedure that provides the "dynamic" background updates
 //	from the frame buffer to the LCD thus disconnecting the firmware
 //	requirement to output data from the displays ability to accept it.
 //
-
-
-//	JEFF
-//	NOTE/	This routine will be .. slow .. since it is effectively
-//		synchronising its updates with the throughput of the
-//		LCD driver (using the _flag signal to hand control back
-//		and forth between them).  It *may* be faster to implement
-//		a system of "over driving" the LCD with data - it does have
-//		a queue for this purpose.
-//
-//		This will require some sort of counter used to monitor the
-//		size of the "over drive".
+//	The refresh process is driven by the flag which the LCD
+//	releases as each action completes.  Clean cells are skipped
+//	over without calling on the LCD, and when there are no dirty
+//	cells left the process stops (leaving the flag empty) until
+//	write_char() or clear() wake it again.
 //
-//		Another thought - why not keep a count of "dirty" bytes
-//		and fill int the LCD queue until it is full?
+//	The LCD address counter is modelled in _address so that the
+//	cursor is only re-positioned when the LCD will not already
+//	be at the next dirty cell.  Where a short run of clean cells
+//	separates the LCD from the next dirty cell these are written
+//	again, which is cheaper than re-positioning.
 //
-//	Need to be smart here - really possibility of make a spin for ever loop!
+//	If the LCD has reset itself after a failed transfer then
+//	the actions queued with it were dropped, and the model of
+//	its address counter is wrong, so the whole frame is sent
+//	again from an unknown address.
 //
 void FrameBuffer::process( void ) {
-	byte	i, c;
+	byte	i, j, n, s, r, c, a, v, gap, fill, target;
 	
 	//
 	//	Frame buffer support.
 	//	=====================
 	//
+	//	Has the LCD been reset since we last looked?
+	//
+	if(( v = _lcd->resets()) != _resets ) {
+		_resets = v;
+		_address = unknown_address;
+		for( i = 0; i < _size; i++ ) _buffer[ i ] = TAG_DIRTY( _buffer[ i ]);
+		_dirty = _size;
+	}
+	//
+	//	Anything to do?  If not go to sleep.
+	//
+	if( _dirty == 0 ) {
+		_idle = true;
+		return;
+	}
+	//
 	//	The _chk_r and _chk_c variables give the current position
 	//	of where we are looking in the buffer.
 	//
-	//	Is there something to do at the current scan position?
+	//	Skip forward to the next dirty cell (there must be one),
+	//	noting where we started and how many cells were skipped.
+	//
+	r = _chk_r;
+	c = _chk_c;
+	gap = 0;
+	n = _size;
+	while( !IS_DIRTY( _buffer[( i = _chk_r * _cols + _chk_c )])) {
+		if( --n == 0 ) {
+			//
+			//	The count is out of step with the buffer; there
+			//	is nothing to do after all.
+			//
+			_dirty = 0;
+			_idle = true;
+			return;
+		}
+		gap++;
+		step( &_chk_r, &_chk_c );
+	}
+	//
+	//	Is the LCD going to put the character in the right place?
+	//	If not, but the gap is short and the cells in it follow
+	//	on from where the LCD is, then we back up and write the
+	//	gap as well.
 	//
-	c = _buffer[( i = _chk_r * _cols + _chk_c )];
-	if( IS_DIRTY( c )) {
+	target = _lcd->address( i );
+	fill = 0;
+	if(( _address != target )&&( _address != unknown_address )&&( gap > 0 )&&( gap <= maximum_gap )) {
+		byte	gr, gc;
+
+		gr = r;
+		gc = c;
+		a = _address;
+		for( n = 0; ( n < gap )&&( _lcd->address( gr * _cols + gc ) == a ); n++ ) {
+			a = _lcd->advance( a );
+			step( &gr, &gc );
+		}
+		if(( n == gap )&&( a == target )) {
+			_chk_r = r;
+			_chk_c = c;
+			fill = gap;
+			target = _address;
+		}
+	}
+	if( _address != target ) {
 		//
-		//	All "pending" updates in the frame buffer have
-		//	their top bit set. Once a position has been updated
-		//	This bit is reset.
+		//	We need to move the output cursor on the LCD
+		//	to where we need to output a pending character.
 		//
-		if( _sync ) {
+		if( _lcd->index( i, &_flag )) {
 			//
-			//	We can just directly output the character
-			//	to the display.
+			//	If the index function is successful then
+			//	the LCD and scan positions are synchronised.
 			//
-			c = TAG_CLEAN( c );
-			if( _lcd->write( c, &_flag )) {
-				//
-				//	Success, update frame buffer, move
-				//	next and last on wards.
-				//
-				_buffer[ i ] = c;
-				//
-				//	Now move on the next and last values.
-				//
-				//	But .. remembering that the LCD does
-				//	not wrap across the edge of the display.
-				//
-				if(( _chk_c += 1 ) >= _cols ) {
-					//
-					//	If we "run off" the edge of the
-					//	line then we will have to get the
-					//	LCD to re-position its cursor.
-					//
-					_sync = false;
-					_chk_c = 0;
-					if(( _chk_r += 1 ) >= _rows ) {
-						_chk_r = 0;
-					}
-				}
-			}
+			_address = target;
 		}
 		else {
 			//
-			//	We need to move the output cursor on the LCD
-			//	to where we need to output a pending character.
+			//	The LCD queue is full; try again later.
 			//
-			if( _lcd->index( i, &_flag )) {
-				//
-				//	If the index function is successful then
-				//	we can move the LCD note that the LCD and
-				//	scan positions are synchronised.
-				//
-				_sync = true;
-			}
+			_flag.release();
 		}
+		return;
 	}
-	else {
+	//
+	//	We can just directly output the characters to the
+	//	display.  Count the run of cells from here which the
+	//	LCD will step through by itself (limited by what the
+	//	LCD can take in one burst and has space to queue) so
+	//	they can all be handed to the LCD together.  The run
+	//	covers the gap being filled, then stops at the first
+	//	clean cell.  Only the last carries our flag.
+	//
+	if(( s = _lcd->space()) > LCD::burst_chars ) s = LCD::burst_chars;
+	if( s == 0 ) {
 		//
-		//	Any character we have "skipped" over means that
-		//	the output LCD cursor is in the wrong place, so
-		//	we reset for sync flag.
+		//	The LCD queue is full; try again later.
 		//
-		_sync = false;
+		_flag.release();
+		return;
+	}
+	r = _chk_r;
+	c = _chk_c;
+	a = _address;
+	for( n = 1; n < s; n++ ) {
+		a = _lcd->advance( a );
+		step( &r, &c );
+		j = r * _cols + c;
+		if( _lcd->address( j ) != a ) break;
+		if(( n >= fill )&& !IS_DIRTY( _buffer[ j ])) break;
+	}
+	while( n-- ) {
 		//
-		//	Move on to the next byte, and wrap if we get to
-		//	the bottom of the display.
+		//	Update frame buffer, then move the scan and the
+		//	LCD address on wards.
 		//
-		if(( _chk_c += 1 ) >= _cols ) {
-			_chk_c = 0;
-			if(( _chk_r += 1 ) >= _rows ) {
-				_chk_r = 0;
-			}
+		v = _buffer[( i = _chk_r * _cols + _chk_c )];
+		if( IS_DIRTY( v )) {
+			_buffer[ i ] = ( v = TAG_CLEAN( v ));
+			_dirty--;
 		}
-		//
-		//	Finally we "self schedule ourselves again because
-		//	we haven't sent anything out yet (so the LCD code
-		//	will not wake us up).
-		//
-		//	This *WILL* lead to wasted cycles as the frame
-		//	buffer spin loops when the buffer is static and
-		//	unchanging.
-		//
-		//	JEFF - bad design here 
-		//
-		_flag.release();
+		(void)_lcd->write( v, n? NIL( Signal ): &_flag );
+		_address = _lcd->advance( _address );
+		step( &_chk_r, &_chk_c );
 	}
 }
 
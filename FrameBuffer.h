@@ -23,6 +23,17 @@
 //
 class FrameBuffer : public Task_Entry {
 private:
+	//
+	//	The LCD address counter value used when the address
+	//	is not known, and the longest run of unchanged cells
+	//	which will be written again rather than moving the
+	//	cursor over them.  Both cost one 37us LCD action per
+	//	cell, but the rewritten cells join the burst which
+	//	follows.
+	//
+	static const byte	unknown_address = ERROR_BYTE;
+	static const byte	maximum_gap = 2;
+
 	//
 	//	Our target LCD.
 	//
@@ -44,8 +55,17 @@ private:
 	//
 	//	_cursor		Insert point for next output text.
 	//
-	//	_sync		True if the LCD position is synchronised
-	//			with the buffer scan position (r,c).
+	//	_address	The LCD display memory address the LCD will
+	//			place the next character at (as far as we
+	//			know), or unknown_address.
+	//
+	//	_dirty		The number of cells waiting to be sent
+	//			to the LCD.
+	//
+	//	_idle		True if the refresh process has stopped
+	//			as there was nothing to send.
+	//
+	//	_resets		The LCD reset count when last checked.
 	//
 	byte		*_buffer,			// Buffer area.
 			_rows,				// Dimension of frame buffer
@@ -54,13 +74,27 @@ private:
 			_chk_r,				// The Row and Col position of
 			_chk_c,				//   the buffer scanning code.
 			_cursor;			// index into buffer
-	bool		_sync;				// Cursor synchronised with scan?
+	byte		_address;			// LCD address counter.
+	bool		_idle;				// Nothing to send?
+	byte		_dirty;				// Cells waiting to be sent.
+	byte		_resets;			// LCD resets seen.
 
 	//
 	//	Declare the control flag used to interface with the
 	//	LCD driver.
 	//
 	Signal		_flag;
+
+	//
+	//	Restart the refresh process if it has stopped.
+	//
+	void wake( void );
+
+	//
+	//	Move a scan position to the next cell, in LCD display
+	//	memory order.
+	//
+	void step( byte *r, byte *c );
 	
 public:
 	FrameBuffer( void );
@@ -74,6 +74,8 @@ Function::cache *Function::find( word target ) {
 	//	we know nothing about them).
 	//
 	last->target = target;
+	last->speed = DCC_Constant::stationary;
+	last->direction = DCC_Constant::direction_forwards;
 	for( byte i = 0; i < bit_array; last->bits[ i++ ] = 0 );
 	
 	//
@@ -111,6 +113,8 @@ Function::Function( void ) {
 		//	Empty the record.
 		//
 		ptr->target = 0;
+		ptr->speed = DCC_Constant::stationary;
+		ptr->direction = DCC_Constant::direction_forwards;
 		for( byte j = 0; j < bit_array; ptr->bits[ j++ ] = 0 );
 		
 		//
@@ -185,6 +189,45 @@ byte Function::get( word target, byte func, byte val ) {
 	return( 0 );
 }
 
+//
+//	Record the speed and direction last sent to the
+//	specified target.
+//
+void Function::motion( word target, byte speed, byte direction ) {
+	cache	*ptr;
+
+	ptr = find( target );
+	ptr->speed = speed;
+	ptr->direction = direction;
+}
+
+//
+//	Return the number of records in the cache.
+//
+byte Function::records( void ) {
+	return( cache_size );
+}
+
+//
+//	Return the state of the cache record at the index supplied.
+//
+//	This walks the record array directly (not the LRU list) so
+//	that an ordered scan is not disturbed by the cache being
+//	used between calls.
+//
+bool Function::fetch( byte index, word *target, byte *speed, byte *direction, byte fn[ DCC_Constant::bit_map_array ]) {
+	cache	*ptr;
+
+	if( index >= cache_size ) return( false );
+	ptr = &( _record[ index ]);
+	if( ptr->target == 0 ) return( false );
+	*target = ptr->target;
+	*speed = ptr->speed;
+	*direction = ptr->direction;
+	for( byte i = 0; i < DCC_Constant::bit_map_array; i++ ) fn[ i ] = ( i < bit_array )? ptr->bits[ i ]: 0;
+	return( true );
+}
+
 
 
 
@@ -27,6 +27,11 @@
 //	allow individual function adjustment without setting/resetting
 //	between 3 to 7 other functions at the same time.
 //
+//	The cache also keeps the last speed and direction sent to
+//	each decoder so that the complete state of the active
+//	mobile decoders can be reported back to the host (or
+//	re-sent to the decoders).
+//
 
 
 //
@@ -62,6 +67,8 @@ private:
 	//
 	struct cache {
 		word		target;
+		byte		speed,
+				direction;
 		byte		bits[ bit_array ];
 		cache		*next,
 				**prev;
@@ -104,6 +111,23 @@ public:
 	//
 	byte get( word target, byte func, byte val );
 
+	//
+	//	Record the speed and direction last sent to the
+	//	specified target.
+	//
+	void motion( word target, byte speed, byte direction );
+
+	//
+	//	Return the number of records in the cache.
+	//
+	byte records( void );
+
+	//
+	//	Return the state of the cache record at the index (0 to
+	//	records()-1) supplied.  Returns false if the record is
+	//	not in use, true otherwise.
+	//
+	bool fetch( byte index, word *target, byte *speed, byte *direction, byte fn[ DCC_Constant::bit_map_array ]);
 
 };
 
@@ -87,7 +87,7 @@ void Keypad::process( void ) {
 			//
 			//	Send the scan code:
 			//
-			if( twi.send_data( _adrs, &_buffer, 1, &_gate, &_result )) {
+			if( twi.send_data( _adrs, &_buffer, 1, &_gate, &_result, TWI::priority_input )) {
 				//
 				//	Successfully scheduled transaction, so move the state to "read_scancode"
 				//	and wait for the TWI device to flag that the command has completed.
@@ -143,7 +143,7 @@ void Keypad::process( void ) {
 			//
 			//	Initiate the read of the scan data:
 			//
-			if( twi.receive_byte( _adrs, &_buffer, &_gate, &_result )) {
+			if( twi.receive_byte( _adrs, &_buffer, &_gate, &_result, TWI::priority_input )) {
 				//
 				//	Successfully scheduled the read of the scan code, so set
 				//	state to "scan_completed" and await the reply.
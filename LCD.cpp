@@ -27,6 +27,7 @@
 #include "Errors.h"
 #include "Task.h"
 #include "Clock.h"
+#include "Code_Assurance.h"
 
 
 //
@@ -38,12 +39,15 @@
 //	Define two "system" programs which are used to handle situations
 //	that arise during the LCDs operation.
 //
-static const LCD::mc_state LCD::mc_idle_program[] PROGMEM = {
+//	The reset program is also queued (and waited on) by initialise(),
+//	so it has to finish up and release the caller's signal.
+//
+const LCD::mc_state LCD::mc_idle_program[] PROGMEM = {
 	mc_idle
 };
-static const LCD::mc_state LCD::mc_reset_program[] PROGMEM = {
+const LCD::mc_state LCD::mc_reset_program[] PROGMEM = {
 	mc_reset, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_40000us, mc_delay_wait,
-	mc_idle
+	mc_finish_up, mc_idle
 };
 
 //
@@ -51,71 +55,82 @@ static const LCD::mc_state LCD::mc_reset_program[] PROGMEM = {
 //	sequence and have to use timed delays to complete their
 //	operating sequence.
 //
-static const LCD::mc_state LCD::mc_init_long_delay[] PROGMEM = {
+const LCD::mc_state LCD::mc_init_long_delay[] PROGMEM = {
 	mc_inst_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
 	mc_inst_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_4200us, mc_delay_wait,
 	mc_finish_up, mc_idle
 };
-static const LCD::mc_state LCD::mc_init_medium_delay[] PROGMEM = {
+const LCD::mc_state LCD::mc_init_medium_delay[] PROGMEM = {
 	mc_inst_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
 	mc_inst_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_150us, mc_delay_wait,
 	mc_finish_up, mc_idle
 };
-static const LCD::mc_state LCD::mc_init_short_delay[] PROGMEM = {
+const LCD::mc_state LCD::mc_init_short_delay[] PROGMEM = {
 	mc_inst_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
 	mc_inst_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
 	mc_finish_up, mc_idle
 };
 
 //
-//	The Instruciton and Data programs now use the "Busy Flag"
-//	to determine if the LCD is ready to accept the next command.
+//	The Instruction and Data programs wait a fixed period after
+//	sending the value, long enough for the LCD to have acted
+//	upon it.
 //
-static const LCD::mc_state LCD::mc_send_inst[] PROGMEM = {
-#if _LCD_USE_READ_BUSY_READY_
-	mc_begin_wait,
-	mc_status_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_status_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_read_buffer, mc_wait_on_done, mc_store_high_data,
-	mc_status_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_status_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_read_buffer, mc_wait_on_done, mc_store_low_data,
-	mc_wait_loop,
-	mc_inst_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_inst_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_inst_low_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_inst_low_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
+//	Instructions fall into two classes: clear and home take
+//	1.52ms to execute and use the slow program, everything else
+//	(including setting the cursor position) completes in 37us,
+//	the same as writing a character.
+//
+//	On the host emulator (make -C host bench), and so in simulated
+//	time, a cursor position takes 650us from being queued to being
+//	complete and a home 2250us, most of the former being the four
+//	bytes on the bus.  Timing every instruction as slow made the
+//	position take 2200us too.
+//
+//	All send the four bytes which clock a value into the LCD
+//	as a single burst.  The data program will also take any
+//	further characters waiting in the queue into the same
+//	burst.
+//
+const LCD::mc_state LCD::mc_send_inst[] PROGMEM = {
+	mc_inst_burst, mc_transmit_burst, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
 	mc_finish_up, mc_idle
-#else
-	mc_inst_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_inst_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_inst_low_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_inst_low_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_1600us, mc_delay_wait,
+};
+const LCD::mc_state LCD::mc_send_slow_inst[] PROGMEM = {
+	mc_inst_burst, mc_transmit_burst, mc_wait_on_done, mc_set_delay_1600us, mc_delay_wait,
 	mc_finish_up, mc_idle
-#endif
 };
-static const LCD::mc_state LCD::mc_send_data[] PROGMEM = {
-#if _LCD_USE_READ_BUSY_READY_
+const LCD::mc_state LCD::mc_send_data[] PROGMEM = {
+	mc_data_burst, mc_transmit_burst, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
+	mc_finish_up, mc_idle
+};
+
+//
+//	When busy flag polling is enabled the programs above are
+//	replaced with these, which read the "Busy Flag" to determine
+//	if the LCD is ready to accept the next value before sending
+//	it, and do not wait afterwards.  Both instruction classes
+//	use the same program.
+//
+//	Each status read is a single exchange (see mc_status_read),
+//	and both nybbles have to be read to complete the LCD read
+//	cycle, though only the busy flag in the first is kept.
+//
+const LCD::mc_state LCD::mc_poll_inst[] PROGMEM = {
 	mc_begin_wait,
-	mc_status_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_status_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_read_buffer, mc_wait_on_done, mc_store_high_data,
-	mc_status_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_status_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_read_buffer, mc_wait_on_done, mc_store_low_data,
+	mc_status_read, mc_wait_on_read, mc_store_status,
+	mc_status_read, mc_wait_on_read,
 	mc_wait_loop,
-	mc_data_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_data_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_data_low_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_data_low_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
+	mc_inst_burst, mc_transmit_burst, mc_wait_on_done,
 	mc_finish_up, mc_idle
-#else
-	mc_data_high_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_data_high_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
-	mc_data_low_enable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_10us, mc_delay_wait,
-	mc_data_low_disable, mc_transmit_buffer, mc_wait_on_done, mc_set_delay_37us, mc_delay_wait,
+};
+const LCD::mc_state LCD::mc_poll_data[] PROGMEM = {
+	mc_begin_wait,
+	mc_status_read, mc_wait_on_read, mc_store_status,
+	mc_status_read, mc_wait_on_read,
+	mc_wait_loop,
+	mc_data_burst, mc_transmit_burst, mc_wait_on_done,
 	mc_finish_up, mc_idle
-#endif
 };
 
 
@@ -166,6 +181,44 @@ void LCD::queue_transfer_wait( const LCD::mc_state *program, byte value ) {
 	while( !wait.acquire()) task_manager.pole_task();
 }
 
+//
+//	void burst_nybbles( byte value, byte mode )
+//	-------------------------------------------
+//
+//	Append the four bytes which clock the value into the LCD
+//	to the end of the burst buffer, with the mode (register
+//	select) bits given.
+//
+void LCD::burst_nybbles( byte value, byte mode ) {
+	byte	*b;
+
+	ASSERT( _fsm_burst_len <= burst_size - 4 );
+
+	b = _fsm_burst + _fsm_burst_len;
+	mode |= _back_light;
+	b[ 0 ] = high_nybble( value ) | mode | bit( enable );
+	b[ 1 ] = high_nybble( value ) | mode;
+	b[ 2 ] = low_nybble( value ) | mode | bit( enable );
+	b[ 3 ] = low_nybble( value ) | mode;
+	_fsm_burst_len += 4;
+}
+
+//
+//	void polling_failed( void )
+//	---------------------------
+//
+//	Abandon reading the busy flag, and restart the current
+//	action using its timed program.  The LCD may be part way
+//	through a read cycle, so the burst is started with the
+//	E=0 status byte which completes it.
+//
+void LCD::polling_failed( void ) {
+	_busy_poll = false;
+	_fsm_burst[ 0 ] = 0xf0 | _back_light | bit( read_write );
+	_fsm_burst_len = 1;
+	_fsm_instruction = _fsm_program;
+}
+
 //
 //	Constructor!
 //	============
@@ -196,9 +249,14 @@ LCD::LCD( void ) {
 	//	data transmission to the LCD
 	//
 	_fsm_instruction = mc_idle_program;
+	_fsm_program = mc_idle_program;
 	_fsm_loop = NIL( mc_state );
+	_fsm_polls = 0;
 	_fsm_data_byte = 0;
 	_fsm_buffer = 0;
+	_fsm_burst_len = 0;
+	_busy_poll = false;
+	_resets = 0;
 }
 
 void LCD::initialise( byte adrs, byte rows, byte cols ) {
@@ -275,6 +333,11 @@ void LCD::initialise( byte adrs, byte rows, byte cols ) {
 	cursor( false );
 	blink( false );
 	backlight( true );
+	//
+	//	The busy flag can only be read once the LCD is in 4 bit
+	//	mode, so polling (if configured) starts here.
+	//
+	busy_flag( LCD_BUSY_FLAG );
 }
 
 //
@@ -302,8 +365,27 @@ main_loop:
 				//	the queue.
 				//
 				_fsm_data_byte = _queue[ _queue_out ].value;
-				_fsm_instruction = _queue[ _queue_out ].program;
+				_fsm_program = _queue[ _queue_out ].program;
 				_fsm_flag = _queue[ _queue_out ].flag;
+				_fsm_burst_len = 0;
+				//
+				//	Swap in the polled version of the program if
+				//	we are reading the busy flag.
+				//
+				if( _busy_poll ) {
+					if( _fsm_program == mc_send_data ) {
+						_fsm_instruction = mc_poll_data;
+					}
+					else if(( _fsm_program == mc_send_inst )||( _fsm_program == mc_send_slow_inst )) {
+						_fsm_instruction = mc_poll_inst;
+					}
+					else {
+						_fsm_instruction = _fsm_program;
+					}
+				}
+				else {
+					_fsm_instruction = _fsm_program;
+				}
 
 				if(( _queue_out += 1 ) >= max_pending ) _queue_out = 0;
 				_queue_len--;
@@ -402,32 +484,22 @@ main_loop:
 			_fsm_instruction++;
 			goto main_loop;
 		};
-		case mc_status_enable: {	// send status request with E=1 as inst
+		case mc_status_read: {		// read the busy flag and address counter nybble
 			//
-			//	RS = 0	(Select IR)
-			//	R/W = 1 (Read)
-			//	E = 1	(Enable)
-			//
-			_fsm_buffer = 0xf0 | _back_light | bit( read_write ) | bit( enable );
-			_fsm_instruction++;
-			goto main_loop;
-		};
-		case mc_status_disable: {	// send status request with E=0 as inst
+			//	Send two bytes, with E=0 then E=1, selecting a
+			//	status read:
 			//
 			//	RS = 0	(Select IR)
 			//	R/W = 1 (Read)
-			//	E = 0	(Disable)
 			//
-			_fsm_buffer = 0xf0 | _back_light | bit( read_write );
-			_fsm_instruction++;
-			goto main_loop;
-		};
-		case mc_read_buffer: {		// read the interface into the buffer
-			//
-			//	We read and read again until this returns true then
-			//	move to the next instruction
+			//	then (while E is still 1) read the expander pins
+			//	back.  The data lines are written as 1s so they
+			//	can be pulled down by the LCD.  The E=0 byte
+			//	completes any previous read cycle.
 			//
-			if( twi.receive_byte( _adrs, &_fsm_buffer, &_flag, &_error )) {
+			_fsm_status[ 0 ] = 0xf0 | _back_light | bit( read_write );
+			_fsm_status[ 1 ] = _fsm_status[ 0 ] | bit( enable );
+			if( twi.exchange( _adrs, _fsm_status, 2, 1, &_flag, &_error, TWI::priority_display )) {
 				//
 				//	Sent the TWI command; we will be woken up when the
 				//	command is completed.
@@ -440,28 +512,29 @@ main_loop:
 				//	code and try again in a short while.
 				//
 				if( !event_timer.delay_event( processing_delay, &_flag, false )) {
-					//
-					//	Failing to schedule an actual timed delay, we log an error
-					//	and then effect a 0 second delay by self-scheduling
-					//	the task manager to call us again.
-					//
 					errors.log_error( EVENT_TIMER_QUEUE_FULL, LCD_PROCESSING_DELAY );
 					_flag.release();
 				}
 			}
-			//
-			//	If all cases, when we get here we are expecting the flag signal
-			//	to initiate this code to restarted.
-			//
 			break;
 		}
-		case mc_store_high_data: {	// place buffer into data high bits
-			_fsm_data_byte = ( _fsm_buffer & 0xf0 )|( _fsm_data_byte & 0x0f );
-			_fsm_instruction++;
+		case mc_wait_on_read: {		// Wait for a status read to complete
+			//
+			//	A failed status read is not fatal, as nothing has
+			//	been sent to the LCD yet.  Polling is abandoned and
+			//	the timed version of the program run instead.
+			//
+			if( _error == TWI::error_none ) {
+				_fsm_instruction++;
+			}
+			else {
+				errors.log_error( I2C_COMMS_ERROR, _error );
+				polling_failed();
+			}
 			goto main_loop;
 		}
-		case mc_store_low_data: {	// place buffer into data high bits
-			_fsm_data_byte = (( _fsm_buffer & 0xf0 ) >> 4 )|( _fsm_data_byte & 0xf0 );
+		case mc_store_status: {		// keep the busy flag from the status read
+			_fsm_buffer = _fsm_status[ 0 ];
 			_fsm_instruction++;
 			goto main_loop;
 		}
@@ -470,7 +543,7 @@ main_loop:
 			//	We send and send again until this returns true then
 			//	move to the next instruction
 			//
-			if( twi.send_data( _adrs, &_fsm_buffer, 1, &_flag, &_error )) {
+			if( twi.send_data( _adrs, &_fsm_buffer, 1, &_flag, &_error, TWI::priority_display )) {
 				//
 				//	Sent the TWI command; we will be woken up when the
 				//	command is completed.
@@ -498,6 +571,54 @@ main_loop:
 			//
 			break;
 		}
+		case mc_inst_burst: {		// fill burst with all four inst bytes
+			//
+			//	RS = 0	(Select IR)
+			//	R/W = 0 (Write)
+			//
+			burst_nybbles( _fsm_data_byte, 0 );
+			_fsm_instruction++;
+			goto main_loop;
+		}
+		case mc_data_burst: {		// fill burst with data bytes from the queue
+			//
+			//	RS = 1	(Select DR)
+			//	R/W = 0 (Write)
+			//
+			burst_nybbles( _fsm_data_byte, bit( register_select ));
+			//
+			//	Take further characters from the head of the queue
+			//	while there is space in the burst.  Only the last
+			//	character in a burst may have a signal attached,
+			//	so we stop after taking one that has.
+			//
+			while( _queue_len &&( _fsm_flag == NIL( Signal ))&&( _fsm_burst_len <= burst_size - 4 )&&( _queue[ _queue_out ].program == mc_send_data )) {
+				_fsm_data_byte = _queue[ _queue_out ].value;
+				_fsm_flag = _queue[ _queue_out ].flag;
+				burst_nybbles( _fsm_data_byte, bit( register_select ));
+
+				if(( _queue_out += 1 ) >= max_pending ) _queue_out = 0;
+				_queue_len--;
+			}
+			_fsm_instruction++;
+			goto main_loop;
+		}
+		case mc_transmit_burst: {	// send the content of the burst
+			//
+			//	As with mc_transmit_buffer, but sending the whole
+			//	burst buffer as a single transaction.
+			//
+			if( twi.send_data( _adrs, _fsm_burst, _fsm_burst_len, &_flag, &_error, TWI::priority_display )) {
+				_fsm_instruction++;
+			}
+			else {
+				if( !event_timer.delay_event( processing_delay, &_flag, false )) {
+					errors.log_error( EVENT_TIMER_QUEUE_FULL, LCD_PROCESSING_DELAY );
+					_flag.release();
+				}
+			}
+			break;
+		}
 		case mc_wait_on_done: {		// Wait for the TWI action to complete
 			//
 			//	Transmission completed
@@ -547,8 +668,10 @@ main_loop:
 				_queue_out = 0;
 				//
 				//	Now we execute the "reset program" to try
-				//	restore control of the LCD.
+				//	restore control of the LCD, and count it
+				//	so our users know to start again.
 				//
+				_resets++;
 				_fsm_instruction = mc_reset_program;
 				_fsm_loop = NIL( mc_state );
 				_fsm_flag = NIL( Signal );
@@ -561,19 +684,39 @@ main_loop:
 			//	after this one (no need to re-run this code
 			//	for each loop.
 			//
+			_fsm_polls = 0;
 			_fsm_loop = ++_fsm_instruction;
 			goto main_loop;
 		}
 		case mc_wait_loop: {		// If not ready loop again
 			//
 			//	The Busy Flag is the top bit of the data recovered from
-			//	the LCD.
+			//	the LCD, and is set while the LCD is busy.
 			//
-			if( _fsm_data_byte & 0x80 ) {
-				_fsm_instruction++;
+			if( _fsm_buffer & 0x80 ) {
+				//
+				//	Still busy.  If the LCD stays busy far longer
+				//	than any instruction takes then the reads are
+				//	not working (the data lines are floating high)
+				//	so give up on polling.
+				//
+				if(( _fsm_polls += 1 ) >= busy_polls ) {
+					errors.log_error( I2C_COMMS_ERROR, TWI::error_timed_out );
+					polling_failed();
+				}
+				else {
+					_fsm_instruction = _fsm_loop;
+				}
 			}
 			else {
-				_fsm_instruction = _fsm_loop;
+				//
+				//	Ready.  The burst which follows starts with the
+				//	E=0 status byte so the read cycle is completed
+				//	before RS and R/W are changed.
+				//
+				_fsm_burst[ 0 ] = 0xf0 | _back_light | bit( read_write );
+				_fsm_burst_len = 1;
+				_fsm_instruction++;
 			}
 			goto main_loop;
 		}
@@ -726,14 +869,14 @@ bool LCD::clear( Signal *flag ) {
 
 	TRACE_LCD( console.write( 'C' ));
 	
-	return( queue_transfer( mc_send_inst, clear_screen, flag ));
+	return( queue_transfer( mc_send_slow_inst, clear_screen, flag ));
 }
 
 bool LCD::home( Signal *flag ) {
 
 	TRACE_LCD( console.write( 'H' ));
 	
-	return( queue_transfer( mc_send_inst, home_screen,flag ));
+	return( queue_transfer( mc_send_slow_inst, home_screen, flag ));
 }
 
 bool LCD::leftToRight( bool l2r, Signal *flag ) {
@@ -807,26 +950,49 @@ bool LCD::index( byte posn, Signal *flag ) {
 	//
 	//	This "ignores" the underlying memory mapping which
 	//	effectively shuffles the rows.
+	//
+	return( queue_transfer( mc_send_inst, set_position | address( posn ), flag ));
+}
+
+byte LCD::address( byte posn ) {
 	//
 	//	Line 0
 	//
-	if( posn < _cols ) return( queue_transfer( mc_send_inst, set_position | posn, flag ));
+	if( posn < _cols ) return( posn );
 	//
 	//	Line 1
 	//
-	if(( posn -= _cols ) < _cols ) return( queue_transfer( mc_send_inst, set_position |( 0x40 + posn ), flag ));
+	if(( posn -= _cols ) < _cols ) return( 0x40 + posn );
 	//
 	//	Line 2
 	//
-	if(( posn -= _cols ) < _cols ) return( queue_transfer( mc_send_inst, set_position |( _cols + posn ), flag ));
+	if(( posn -= _cols ) < _cols ) return( _cols + posn );
 	//
 	//	Line 3
 	//
-	if(( posn -= _cols ) < _cols ) return( queue_transfer( mc_send_inst, set_position |( 0x40 + _cols + posn ), flag ));
+	if(( posn -= _cols ) < _cols ) return( 0x40 + _cols + posn );
 	//
 	//	Out of bounds, put it top left, position 0.
 	//
-	return( queue_transfer( mc_send_inst, set_position, flag ));
+	return( 0 );
+}
+
+byte LCD::advance( byte adrs ) {
+	//
+	//	With a single line the display memory is one run of
+	//	80 bytes.  With two (or four) lines it is two runs of
+	//	40 bytes, at 0x00 and 0x40, and the address counter
+	//	moves from the end of one to the start of the other.
+	//
+	adrs++;
+	if( _rows == 1 ) {
+		if( adrs >= 0x50 ) adrs = 0x00;
+	}
+	else {
+		if( adrs == 0x28 ) adrs = 0x40;
+		if( adrs >= 0x68 ) adrs = 0x00;
+	}
+	return( adrs );
 }
 
 bool LCD::write( byte val, Signal *flag ) {
@@ -837,6 +1003,22 @@ bool LCD::write( byte val, Signal *flag ) {
 	return( queue_transfer( mc_send_data, val, flag ));
 }
 
+void LCD::busy_flag( bool poll ) {
+	_busy_poll = poll;
+}
+
+bool LCD::polling( void ) {
+	return( _busy_poll );
+}
+
+byte LCD::space( void ) {
+	return( max_pending - _queue_len );
+}
+
+byte LCD::resets( void ) {
+	return( _resets );
+}
+
 
 //
 //	EOF
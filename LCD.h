@@ -29,6 +29,16 @@
 #include "Signal.h"
 #include "TWI.h"
 
+//
+//	The nybble bursts rely on the time taken to clock each byte
+//	across the bus to space out the enable pulses and the
+//	characters (see "Output State" below), which only holds at
+//	up to 100KHz.
+//
+#if TWI_FREQ > 10
+#error "The LCD nybble bursts need a TWI_FREQ of 10 (100KHz) or less"
+#endif
+
 //
 //	Set up default value for the target address and size of the LCD.
 //
@@ -45,6 +55,40 @@
 #define LCD_PROCESSING_DELAY	5
 #endif
 
+//
+//	Set the number of consecutive characters which can be
+//	packed into a single TWI transaction.  Each character
+//	takes four bytes on the wire.
+//
+#ifndef LCD_BURST_CHARS
+#define LCD_BURST_CHARS		4
+#endif
+
+//
+//	Set if the LCD busy flag should be read (rather than waiting
+//	a fixed period) to tell when the LCD is ready for the next
+//	instruction or character.  This can also be changed at run
+//	time.
+//
+#ifndef LCD_BUSY_FLAG
+#ifdef _LCD_USE_READ_BUSY_READY_
+#define LCD_BUSY_FLAG		true
+#else
+#define LCD_BUSY_FLAG		false
+#endif
+#endif
+
+//
+//	Set the number of times the busy flag will be found set
+//	before the LCD driver decides the flag is not being read
+//	correctly and falls back to fixed delays.  Each read takes
+//	about 0.4ms at 100KHz, so this comfortably covers the
+//	longest (1.52ms) instruction.
+//
+#ifndef LCD_BUSY_POLLS
+#define LCD_BUSY_POLLS		10
+#endif
+
 //
 //	The controlling class for the module.
 //
@@ -85,6 +129,15 @@ private:
 	//	while the other 4 bits are for the 8 bits of data which are send in parts using the enable
 	//	output.
 	//
+	//	All contact with the display passes through the twi.send_data()
+	//	and twi.exchange() calls made by the machine below, so the LCD
+	//	can be emulated by a TWI replacement which latches D0-D3 on
+	//	each 1 -> 0 transition of E, pairs the nybbles (high first)
+	//	and applies the result to a model of the display memory and
+	//	address counter as LCD::advance() describes.  The host build
+	//	(see host/Makefile) does exactly this to test and time this
+	//	module and the frame buffer away from the hardware.
+	//
 
 	//
 	//	"Output State"
@@ -136,6 +189,15 @@ private:
 	//		llll	?	0	0	1
 	//
 	//	
+	//	The expander does not need a gap between the bytes it is
+	//	sent, so all four bytes for a character (or instruction)
+	//	can be sent as a single TWI transaction.  The time taken
+	//	to clock the bytes out across the bus (about 90us a byte
+	//	at 100KHz, 23us at 400KHz) more than covers the enable
+	//	pulse width and the 37us the LCD needs to act upon a
+	//	character before the next one starts arriving.  Above
+	//	100KHz this no longer holds, so faster TWI_FREQ settings
+	//	are rejected at compile time.
 	//
 	static const byte	output_state	= 0b00000000;
 	//
@@ -225,16 +287,17 @@ private:
 		mc_data_high_disable,	// send high nybble with E=0 as data
 		mc_data_low_enable,	// send low nybble with E=1 as data
 		mc_data_low_disable,	// send low nybble with E=0 as data
-		mc_status_enable,	// send status request with E=1 as inst
-		mc_status_disable,	// send status request with E=0 as inst
+		mc_status_read,		// read a status nybble from the LCD
+		mc_wait_on_read,	// Wait for the status read to complete
+		mc_store_status,	// keep the busy flag from the status read
 		mc_transmit_buffer,	// send content of the buffer
 		mc_wait_on_done,	// Wait for TWI confirmation
-		mc_read_buffer,		// read the interface into the buffer
-		mc_store_high_data,	// place buffer into data high bits
-		mc_store_low_data,	// place buffer into data high bits
 		mc_begin_wait,		// Note the top of the wait loop
 		mc_wait_loop,		// If not ready loop again
 		mc_finish_up,		// Complete any transaction tidy up
+		mc_inst_burst,		// fill burst with all four inst bytes
+		mc_data_burst,		// fill burst with data bytes from the queue
+		mc_transmit_burst,	// send content of the burst
 
 		//
 		//	These should be redundant, eventually.
@@ -281,6 +344,16 @@ private:
 	};
 	static const byte max_pending = 16;
 	//
+	//	The size of the burst buffer, in bytes.  When polling the
+	//	busy flag an extra byte leads the burst to complete the
+	//	status read.
+	//
+	static const byte burst_size = LCD_BURST_CHARS * 4 + 1;
+	//
+	//	The busy flag polling limit.
+	//
+	static const byte busy_polls = LCD_BUSY_POLLS;
+	//
 	//	This is the queue of pending bytes heading out of the
 	//	object towards the LCD.
 	//
@@ -308,6 +381,24 @@ private:
 	//
 	void queue_transfer_wait( const mc_state *program, byte value );
 
+	//
+	//	void burst_nybbles( byte value, byte mode )
+	//	-------------------------------------------
+	//
+	//	Append the four bytes which clock the value into the LCD
+	//	to the end of the burst buffer, with the mode (register
+	//	select) bits given.
+	//
+	void burst_nybbles( byte value, byte mode );
+
+	//
+	//	void polling_failed( void )
+	//	---------------------------
+	//
+	//	Abandon reading the busy flag, and restart the current
+	//	action using its timed program.
+	//
+	void polling_failed( void );
 	
 	//
 	//	Define the variables holding the "state" details of the
@@ -327,17 +418,40 @@ private:
 	static const mc_state mc_init_medium_delay[] PROGMEM;
 	static const mc_state mc_init_short_delay[] PROGMEM;
 	static const mc_state mc_send_inst[] PROGMEM;
+	static const mc_state mc_send_slow_inst[] PROGMEM;
 	static const mc_state mc_send_data[] PROGMEM;
+	static const mc_state mc_poll_inst[] PROGMEM;
+	static const mc_state mc_poll_data[] PROGMEM;
 
 	//
 	//	The variables which the current "program" are operating against.
 	//
 	const mc_state	*_fsm_instruction,
+			*_fsm_program,
 			*_fsm_loop;
 	byte		_fsm_data_byte,
-			_fsm_buffer;
+			_fsm_buffer,
+			_fsm_polls,
+			_fsm_status[ 2 ];
 	Signal		*_fsm_flag;
 
+	//
+	//	True if the busy flag is being read.
+	//
+	bool		_busy_poll;
+
+	//
+	//	Count of the resets run after a failed transfer.
+	//
+	byte		_resets;
+
+	//
+	//	The burst buffer, holding one or more characters (or a
+	//	single instruction) ready to send as one transaction.
+	//
+	byte		_fsm_burst[ burst_size ],
+			_fsm_burst_len;
+
 	//
 	//	Task control signal.
 	//
@@ -345,6 +459,12 @@ private:
 	TWI::error_code	_error;
 
 public:
+	//
+	//	The number of characters which can be sent in a single
+	//	burst.
+	//
+	static const byte	burst_chars = LCD_BURST_CHARS;
+
 	//
 	//	Constructor!
 	//	============
@@ -380,6 +500,36 @@ public:
 	bool position( byte row, byte col, Signal *flag = NIL( Signal ));
 	bool index( byte posn, Signal *flag = NIL( Signal ));
 	bool write( byte val, Signal *flag = NIL( Signal ));
+
+	//
+	//	Return the display memory address of the linear position
+	//	given (as used by index()), and the address the LCD will
+	//	move to after writing a character at the address given
+	//	(assuming left to right text entry).
+	//
+	byte address( byte posn );
+	byte advance( byte adrs );
+
+	//
+	//	Select (or deselect) reading of the busy flag, and
+	//	return if it is being read.  Polling is dropped if the
+	//	flag cannot be read.
+	//
+	void busy_flag( bool poll );
+	bool polling( void );
+
+	//
+	//	Return the number of actions which can be queued before
+	//	the queue is full.
+	//
+	byte space( void );
+
+	//
+	//	Return the (wrapping) count of resets run after a failed
+	//	transfer.  A change means queued actions were dropped
+	//	and the display memory address is no longer known.
+	//
+	byte resets( void );
 };
 
 
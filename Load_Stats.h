@@ -0,0 +1,150 @@
+//
+//	Load_Stats.h
+//	============
+//
+//	Declare a class used to gather the statistics of the load
+//	on a single district: the peak and minimum readings over
+//	a window, the number of times a limit is crossed, the time
+//	spent in each state and a histogram of the readings.
+//
+//	Every update is a fixed (small) amount of work, so this can
+//	be called with every reading taken.
+//
+
+
+#ifndef _LOAD_STATS_H_
+#define _LOAD_STATS_H_
+
+//
+//	Grab what we need.
+//
+#include "Configuration.h"
+#include "Environment.h"
+
+
+//
+//	The Load statistics mechanism, for a given number of
+//	states.
+//
+template< byte STATES >
+class Load_Stats {
+public:
+	//
+	//	The number of states timed and the number of buckets
+	//	in the histogram.  The buckets divide the full 10 bit
+	//	range of the ADC evenly.
+	//
+	static const byte	states = STATES;
+	static const byte	buckets = 8;
+	static const byte	bucket_shift = 7;
+
+private:
+	//
+	//	The window values.
+	//
+	word	_peak,
+		_minimum;
+
+	//
+	//	The limit crossings, and if the last reading was
+	//	above the limit.
+	//
+	word	_crossings;
+	bool	_above;
+
+	//
+	//	The time (in milliseconds) spent in each state, and
+	//	when it was last updated.
+	//
+	dword	_time[ states ],
+		_last;
+
+	//
+	//	The histogram.
+	//
+	word	_bucket[ buckets ];
+
+public:
+	//
+	//	Start a new window for the peak and minimum.
+	//
+	void restart( void ) {
+		_peak = 0;
+		_minimum = MAXIMUM_WORD;
+	}
+
+	//
+	//	Initialise the content.
+	//
+	Load_Stats( void ) {
+		restart();
+		_crossings = 0;
+		_above = false;
+		for( byte i = 0; i < states; _time[ i++ ] = 0 );
+		_last = 0;
+		for( byte i = 0; i < buckets; _bucket[ i++ ] = 0 );
+	}
+
+	//
+	//	Add the time since the last call to the state given.
+	//
+	void time( byte state ) {
+		dword	now;
+
+		now = millis();
+		if( state < states ) _time[ state ] += now - _last;
+		_last = now;
+	}
+
+	//
+	//	Fold in a new reading, counting a crossing each time
+	//	the reading rises above the limit.
+	//
+	void sample( word reading, word limit ) {
+		byte	b;
+
+		if( reading > _peak ) _peak = reading;
+		if( reading < _minimum ) _minimum = reading;
+		if( reading > limit ) {
+			if( !_above &&( _crossings < MAXIMUM_WORD )) _crossings++;
+			_above = true;
+		}
+		else {
+			_above = false;
+		}
+		if(( b = reading >> bucket_shift ) >= buckets ) b = buckets-1;
+		if( _bucket[ b ] < MAXIMUM_WORD ) _bucket[ b ]++;
+	}
+
+	//
+	//	Return the statistics gathered.  Times are returned in
+	//	seconds.
+	//
+	word peak( void ) {
+		return( _peak );
+	}
+	word minimum( void ) {
+		return(( _minimum > _peak )? 0: _minimum );
+	}
+	word crossings( void ) {
+		return( _crossings );
+	}
+	word seconds( byte state ) {
+		dword	s;
+
+		if( state >= states ) return( 0 );
+		if(( s = _time[ state ] / 1000 ) > MAXIMUM_WORD ) return( MAXIMUM_WORD );
+		return( (word)s );
+	}
+	word bucket( byte index ) {
+		if( index >= buckets ) return( 0 );
+		return( _bucket[ index ]);
+	}
+};
+
+
+#endif
+
+//
+//	EOF
+//
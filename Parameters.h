@@ -14,6 +14,13 @@
 //	CLOCK_EVENTS			The maximum number of time related events which can be handled.
 //	CONSOLE_INPUT			The size of the console input buffer
 //	CONSOLE_OUTPUT			The size of the console output buffer
+//	CONSOLE_FLOW_CONTROL		Console receive flow control, FCXonXoff or FCRtsCts
+//	CONSOLE_HIGH_WATER		Input bytes buffered before the host is stopped
+//	CONSOLE_LOW_WATER		Input bytes buffered before the host is restarted
+//	CONSOLE_RTS_PIN			The RTS output pin when using FCRtsCts
+//	HOST_LINK_DEVICE		The USART instance carrying the host link (Mega only by default)
+//	HOST_LINK_INPUT			The size of the host link input buffer
+//	HOST_LINK_OUTPUT		The size of the host link output buffer
 //	TIME_OF_DAY_TASKS		The maximum number of tasks that the time of day code can handle
 //
 //	For debugging purposes
@@ -26,6 +33,7 @@
 #define VERSION_NUMBER		"0.2.3"
 #define SERIAL_BAUD_RATE	B38400
 #define SERIAL_BAUD_RATE_STR	"38400"
+#define HOST_LINK_BAUD_RATE	B115200
 
 #endif
 
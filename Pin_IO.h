@@ -73,8 +73,12 @@ class GPIO_Registers {
 		//	AVR Architectures		//
 		//	=================		//
 		//					//
+		//	The host build (host/Makefile)	//
+		//	uses the AVR layout over	//
+		//	plain memory.			//
+		//					//
 		//////////////////////////////////////////
-#if defined( ARDUINO_ARCH_AVR )
+#if defined( ARDUINO_ARCH_AVR ) || defined( __linux__ )
 
 	private:
 		//
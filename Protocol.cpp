@@ -10,14 +10,20 @@
 #include "Task.h"
 #include "Errors.h"
 #include "Code_Assurance.h"
+#include "Query.h"
+#include "Buffer.h"
+#include "Districts.h"
 
 //
 //	Set up ready to be initialised.
 //
 Protocol::Protocol( void ) {
+	_port = NIL( Byte_Queue_API );
 	_inside = false;
 	_valid = true;
 	_len = 0;
+	_frames = 0;
+	_rejected = 0;
 }
 
 //
@@ -69,26 +75,99 @@ char *Protocol::parse_number( char *buf, bool *found, int *value ) {
 //
 //	Parse an input buffer.
 //
-void Protocol::parse_buffer( UNUSED( char *buf ), UNUSED( int len )) {
+void Protocol::parse_buffer( char *buf, UNUSED( int len )) {
+	//
+	//	The first character is the command.
+	//
+	switch( *buf ) {
+		case query: {
+			//
+			//	Stream back the state of all known decoders.
+			//
+			if( !state_query.start( _port )) errors.log_error( QUERY_IN_PROGRESS, 0 );
+			break;
+		}
+		case occupancy: {
+			Buffer< 16 >	reply;
+
+			//
+			//	Return the number of districts and a bit map
+			//	of those occupied.
+			//
+			if( reply.format( occupancy, districts.count(), districts.occupancy()) &&( _port->space() >= reply.size())) {
+				(void)reply.send( _port );
+			}
+			else {
+				errors.log_error( COMMAND_REPORT_FAIL, occupancy );
+			}
+			break;
+		}
+		case statistics: {
+			//
+			//	Stream back the load statistics of the districts.
+			//
+			if( !state_query.statistics( _port )) errors.log_error( QUERY_IN_PROGRESS, 0 );
+			break;
+		}
+		case bus: {
+			//
+			//	Stream back the health of the TWI bus.
+			//
+			if( !state_query.bus( _port )) errors.log_error( QUERY_IN_PROGRESS, 0 );
+			break;
+		}
+		default: {
+			errors.log_error( INVALID_DCC_COMMAND, *buf );
+			break;
+		}
+	}
 }
 
 
-void Protocol::initialise( void ) {
+void Protocol::initialise( Byte_Queue_API *port, Signal *control ) {
+
+	ASSERT( port != NIL( Byte_Queue_API ));
+	ASSERT( control != NIL( Signal ));
+
 	//
-	//	All we do, really, is link ourselves into the console
+	//	All we do, really, is link ourselves into the serial
 	//	stream.  Now the 'process()' routine is called every
 	//	time there is data to be processed.
 	//
-	task_manager.add_task( this, console_control());
+	_port = port;
+	task_manager.add_task( this, control );
+}
+
+//
+//	Return the serial connection replies should be
+//	sent to.
+//
+Byte_Queue_API *Protocol::port( void ) {
+	return( _port );
+}
+
+//
+//	Return the number of packets parsed and rejected.
+//
+word Protocol::frames( void ) {
+	return( _frames );
+}
+
+word Protocol::rejected( void ) {
+	return( _rejected );
 }
 
 //
 //	The task entry point.
 //
+//	The task manager has already claimed the control signal
+//	for the byte we are about to read, so exactly one byte is
+//	taken from the port per call.
+//
 void Protocol::process( void ) {
-	char	data;
+	byte	data;
 
-	switch(( data = console.read())) {
+	switch(( data = _port->read())) {
 		//
 		//	The protocol wrappers
 		//
@@ -97,7 +176,10 @@ void Protocol::process( void ) {
 			//	A new packet starts here.  If we were already
 			//	inside one then we throw it away.
 			//
-			if( _inside ) errors.log_error( DCC_COMMAND_TRUNCATED, _len );
+			if( _inside ) {
+				errors.log_error( DCC_COMMAND_TRUNCATED, _len );
+				_rejected++;
+			}
 			//
 			//	Set up for a new command to arrive.
 			//
@@ -116,20 +198,24 @@ void Protocol::process( void ) {
 				errors.log_error( DCC_PROTOCOL_ERROR, 0 );
 				break;
 			}
-			if( _len == 0 ) {
-				errors.log_error( DCC_COMMAND_EMPTY, 0 );
-				break;
-			}
-
 			//
 			//	Parse buffer (if there was no error)  and
-			//	reset for next command.
+			//	reset for next command.  An empty packet
+			//	still closes the packet.
 			//
-			if( _valid ) {
+			if( _len == 0 ) {
+				errors.log_error( DCC_COMMAND_EMPTY, 0 );
+				_rejected++;
+			}
+			else if( _valid ) {
 				ASSERT( _len < buffer_size );
 				_buffer[ _len ] = EOS;
+				_frames++;
 				parse_buffer( _buffer, _len );
 			}
+			else {
+				_rejected++;
+			}
 			_len = 0;
 			_inside = false;
 			_valid = true;
@@ -140,15 +226,26 @@ void Protocol::process( void ) {
 			//	Some for a packet or just "other stuff" moving
 			//	on past...
 			//
-			if( _inside ) {
-				if( _len < buffer_size-1 ) {
+			if( _inside && _valid ) {
+				if((( data < SPACE )&& !isspace( data ))||( data >= DELETE )) {
+					//
+					//	Line noise or binary data inside a
+					//	packet, the packet is not usable.
+					//	White space is passed on as the
+					//	parser skips it.  As data is a byte
+					//	0x80 and above fail the DELETE test
+					//	rather than reach isspace() as
+					//	negative values.
+					//
+					_valid = false;
+					errors.log_error( DCC_PROTOCOL_ERROR, data );
+				}
+				else if( _len < buffer_size-1 ) {
 					_buffer[ _len++ ] = data;
 				}
 				else {
-					if( _valid ) {
-						_valid = false;
-						errors.log_error( DCC_COMMAND_TRUNCATED, _len );
-					}
+					_valid = false;
+					errors.log_error( DCC_COMMAND_TRUNCATED, _len );
 				}
 			}
 			break;
@@ -511,6 +608,13 @@ JEFF write stuff here now!
 //
 Protocol protocol;
 
+#ifdef HOST_LINK_DEVICE
+//
+//	The protocol engine on the dedicated host link.
+//
+Protocol host_protocol;
+#endif
+
 
 //
 //	EOF
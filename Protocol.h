@@ -14,10 +14,15 @@
 #include "Parameters.h"
 #include "Configuration.h"
 #include "Task_Entry.h"
+#include "Byte_Queue.h"
+#include "Signal.h"
+#include "Console.h"
 
 //
 //	This class defines and handles the communications protocol
-//	between a computer and the Train Controller (via the USB link).
+//	between a computer and the Train Controller (via the USB link
+//	or a dedicated host link USART).  There is one instance of
+//	the class for each serial connection carrying the protocol.
 //
 class Protocol : public Task_Entry {
 public:
@@ -37,6 +42,14 @@ public:
 	//	Controller reporting.
 	//
 	static const char	error = 'E';		// Returned error report.
+	static const char	telemetry = 'L';	// Periodic load report.
+	static const char	query = 'S';		// Bulk state query.
+	static const char	statistics = 'D';	// District statistics.
+	static const char	histogram = 'H';	// District reading histogram.
+	static const char	occupancy = 'O';	// District occupancy.
+	static const char	bus = 'I';		// TWI bus health.
+	static const char	device = 'T';		// TWI device health.
+	static const char	reverser = 'R';		// Reverser group timing.
 	//
 	//	Controller configuration.
 	//
@@ -49,6 +62,11 @@ public:
 	static const byte	buffer_size = 32;
 
 private:
+	//
+	//	The serial connection this instance is attached to.
+	//
+	Byte_Queue_API	*_port;
+
 	//
 	//	Define the input state and buffer variables.
 	//
@@ -56,6 +74,13 @@ private:
 			_valid;
 	char		_buffer[ buffer_size ];
 	byte		_len;
+
+	//
+	//	Count of packets passed to the parser and of those
+	//	thrown away (empty, truncated or corrupt).
+	//
+	word		_frames,
+			_rejected;
 	
 	//
 	//	Define simple "in string" number parsing routine.
@@ -74,9 +99,24 @@ public:
 	Protocol( void );
 	
 	//
-	//	Set up this object and link into other systems.
+	//	Set up this object and link into other systems.  The
+	//	port is the serial connection the protocol is read
+	//	from (and replied to) and control is the signal
+	//	released as data arrives on it.
+	//
+	void initialise( Byte_Queue_API *port, Signal *control );
+
+	//
+	//	Return the serial connection replies should be
+	//	sent to.
+	//
+	Byte_Queue_API *port( void );
+
+	//
+	//	Return the number of packets parsed and rejected.
 	//
-	void initialise( void );
+	word frames( void );
+	word rejected( void );
 
 	//
 	//	The task entry point.
@@ -89,6 +129,13 @@ public:
 //
 extern Protocol protocol;
 
+#ifdef HOST_LINK_DEVICE
+//
+//	The protocol engine on the dedicated host link.
+//
+extern Protocol host_protocol;
+#endif
+
 #endif
 
 //
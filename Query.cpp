@@ -0,0 +1,327 @@
+//
+//	Query.cpp
+//	=========
+//
+//	Report the complete known state of the mobile and
+//	accessory decoders, or the load statistics of the
+//	districts, back to a host computer.
+//
+
+#include "Query.h"
+#include "Task.h"
+#include "Clock.h"
+#include "Errors.h"
+#include "Buffer.h"
+#include "Protocol.h"
+#include "Function.h"
+#include "Accessory.h"
+#include "Districts.h"
+#include "Console.h"
+#include "Code_Assurance.h"
+
+//
+//	Every reply has to fit in the output queue of the port it
+//	is sent to, or the report would wait for space for ever.
+//
+#ifdef HOST_LINK_DEVICE
+#define QUERY_OUTPUT_LIMIT	(( CONSOLE_OUTPUT < HOST_LINK_OUTPUT )? CONSOLE_OUTPUT: HOST_LINK_OUTPUT )
+#else
+#define QUERY_OUTPUT_LIMIT	CONSOLE_OUTPUT
+#endif
+
+//
+//	Constructor.
+//
+Query::Query( void ) {
+	_stage = stage_idle;
+	_index = 0;
+	_port = NIL( Byte_Queue_API );
+}
+
+//
+//	Link into the task manager.
+//
+void Query::initialise( void ) {
+	static_assert( reply_size <= QUERY_OUTPUT_LIMIT, "Query reply larger than the output queue" );
+	static_assert( statistics_size <= QUERY_OUTPUT_LIMIT, "District statistics reply larger than the output queue" );
+	static_assert( histogram_size <= QUERY_OUTPUT_LIMIT, "District histogram reply larger than the output queue" );
+	static_assert( device_size <= QUERY_OUTPUT_LIMIT, "Bus device reply larger than the output queue" );
+
+	task_manager.add_task( this, &_flag );
+}
+
+//
+//	Start a report to the port supplied.
+//
+bool Query::start( Byte_Queue_API *port ) {
+
+	ASSERT( port != NIL( Byte_Queue_API ));
+
+	if( _stage != stage_idle ) return( false );
+	_port = port;
+	_stage = stage_header;
+	_index = 0;
+	_flag.release();
+	return( true );
+}
+
+//
+//	Start a district statistics report to the port supplied.
+//
+bool Query::statistics( Byte_Queue_API *port ) {
+
+	ASSERT( port != NIL( Byte_Queue_API ));
+
+	if( _stage != stage_idle ) return( false );
+	_port = port;
+	_stage = stage_districts;
+	_index = 0;
+	_flag.release();
+	return( true );
+}
+
+//
+//	Start a TWI bus health report to the port supplied.
+//
+bool Query::bus( Byte_Queue_API *port ) {
+
+	ASSERT( port != NIL( Byte_Queue_API ));
+
+	if( _stage != stage_idle ) return( false );
+	_port = port;
+	_stage = stage_bus;
+	_index = 0;
+	_flag.release();
+	return( true );
+}
+
+//
+//	Send the next reply, returning true if it has been sent
+//	(or there was nothing to send) and false if there was
+//	no space.
+//
+bool Query::next_reply( void ) {
+	Buffer< reply_size >	reply;
+	word			target;
+	byte			speed,
+				direction,
+				fn[ DCC_Constant::bit_map_array ];
+
+	switch( _stage ) {
+		case stage_header: {
+			byte	m, a;
+
+			//
+			//	Count what we are about to send.
+			//
+			m = 0;
+			for( byte i = 0; i < function_cache.records(); i++ ) if( function_cache.fetch( i, &target, &speed, &direction, fn )) m++;
+			a = 0;
+			for( byte i = 0; i < accessory_cache.records(); i++ ) if( accessory_cache.fetch( i, &target, &speed )) a++;
+			if( !reply.format( Protocol::query, m, a )) {
+				errors.log_error( COMMAND_REPORT_FAIL, Protocol::query );
+				_stage = stage_idle;
+				return( true );
+			}
+			if( _port->space() < reply.size()) return( false );
+			(void)reply.send( _port );
+			_stage = stage_mobiles;
+			_index = 0;
+			return( true );
+		}
+		case stage_mobiles: {
+			//
+			//	Skip to the next record in use.
+			//
+			while(( _index < function_cache.records()) && !function_cache.fetch( _index, &target, &speed, &direction, fn )) _index++;
+			if( _index >= function_cache.records()) {
+				_stage = stage_accessories;
+				_index = 0;
+				return( true );
+			}
+			if( reply.format( Protocol::query, target, speed, direction, HL_TO_W( fn[ 1 ], fn[ 0 ]), HL_TO_W( fn[ 3 ], fn[ 2 ]))) {
+				if( _port->space() < reply.size()) return( false );
+				(void)reply.send( _port );
+			}
+			else {
+				errors.log_error( COMMAND_REPORT_FAIL, target );
+			}
+			_index++;
+			return( true );
+		}
+		case stage_accessories: {
+			while(( _index < accessory_cache.records()) && !accessory_cache.fetch( _index, &target, &speed )) _index++;
+			if( _index >= accessory_cache.records()) {
+				_stage = stage_idle;
+				return( true );
+			}
+			if( reply.format( Protocol::accessory, target, speed )) {
+				if( _port->space() < reply.size()) return( false );
+				(void)reply.send( _port );
+			}
+			else {
+				errors.log_error( COMMAND_REPORT_FAIL, target );
+			}
+			_index++;
+			return( true );
+		}
+		case stage_districts: {
+			Buffer< statistics_size >	line;
+			District::statistics_block	*s;
+			word				v[ statistics_values ];
+			byte				n;
+
+			if(!( s = districts.statistics( _index ))) {
+				_stage = stage_reversers;
+				_index = 0;
+				return( true );
+			}
+			n = 0;
+			v[ n++ ] = _index;
+			v[ n++ ] = s->peak();
+			v[ n++ ] = s->minimum();
+			v[ n++ ] = s->crossings();
+			for( byte i = 0; i < District::district_states; v[ n++ ] = s->seconds( i++ ));
+			v[ n++ ] = districts.trips( _index );
+			v[ n++ ] = districts.response( _index );
+			v[ n++ ] = districts.milliamps( _index );
+			if( line.format( Protocol::statistics, n, v )) {
+				if( _port->space() < line.size()) return( false );
+				(void)line.send( _port );
+				//
+				//	The peak and minimum cover the period
+				//	between reports.
+				//
+				s->restart();
+				_stage = stage_histogram;
+				return( true );
+			}
+			errors.log_error( COMMAND_REPORT_FAIL, _index );
+			_index++;
+			return( true );
+		}
+		case stage_histogram: {
+			Buffer< histogram_size >	line;
+			District::statistics_block	*s;
+			word				v[ histogram_values ];
+			byte				n;
+
+			//
+			//	The histogram follows the statistics of
+			//	the same district on a line of its own.
+			//
+			if(( s = districts.statistics( _index ))) {
+				n = 0;
+				v[ n++ ] = _index;
+				for( byte i = 0; i < District::statistics_block::buckets; v[ n++ ] = s->bucket( i++ ));
+				if( line.format( Protocol::histogram, n, v )) {
+					if( _port->space() < line.size()) return( false );
+					(void)line.send( _port );
+				}
+				else {
+					errors.log_error( COMMAND_REPORT_FAIL, _index );
+				}
+			}
+			_stage = stage_districts;
+			_index++;
+			return( true );
+		}
+		case stage_reversers: {
+			Reverser	*r;
+
+			//
+			//	Skip to the next group in use.
+			//
+			while(( _index < Districts::maximum_districts ) && !districts.reverser( _index )) _index++;
+			if( _index >= Districts::maximum_districts ) {
+				_stage = stage_idle;
+				return( true );
+			}
+			r = districts.reverser( _index );
+			if( reply.format( Protocol::reverser, _index, r->latest(), r->worst(), r->resolved(), r->failed())) {
+				if( _port->space() < reply.size()) return( false );
+				(void)reply.send( _port );
+			}
+			else {
+				errors.log_error( COMMAND_REPORT_FAIL, _index );
+			}
+			_index++;
+			return( true );
+		}
+		case stage_bus: {
+			word	v[ 4 ];
+
+			v[ 0 ] = twi.utilisation();
+			v[ 1 ] = twi.recoveries();
+			v[ 2 ] = twi.recovery_time();
+			v[ 3 ] = twi.untracked();
+			if( !reply.format( Protocol::bus, 4, v )) {
+				errors.log_error( COMMAND_REPORT_FAIL, Protocol::bus );
+				_stage = stage_idle;
+				return( true );
+			}
+			if( _port->space() < reply.size()) return( false );
+			(void)reply.send( _port );
+			_stage = stage_devices;
+			_index = 0;
+			return( true );
+		}
+		case stage_devices: {
+			Buffer< device_size >	line;
+			word			v[ device_values ];
+
+			//
+			//	Skip to the next device known.
+			//
+			while(( _index <= TWI::Highest_address ) && !twi.health( _index, v + 1 )) _index++;
+			if( _index > TWI::Highest_address ) {
+				_stage = stage_idle;
+				return( true );
+			}
+			v[ 0 ] = _index;
+			if( line.format( Protocol::device, device_values, v )) {
+				if( _port->space() < line.size()) return( false );
+				(void)line.send( _port );
+			}
+			else {
+				errors.log_error( COMMAND_REPORT_FAIL, _index );
+			}
+			_index++;
+			return( true );
+		}
+		default: {
+			_stage = stage_idle;
+			return( true );
+		}
+	}
+}
+
+//
+//	The task entry point.
+//
+void Query::process( void ) {
+	//
+	//	Send as much as we can.
+	//
+	while( _stage != stage_idle ) {
+		if( !next_reply()) {
+			//
+			//	Out of space; come back shortly.
+			//
+			if( !event_timer.delay_event( MSECS( retry_period ), &_flag, false )) {
+				errors.log_error( EVENT_TIMER_QUEUE_FULL, retry_period );
+				_flag.release();
+			}
+			return;
+		}
+	}
+}
+
+//
+//	The query engine.
+//
+Query state_query;
+
+//
+//	EOF
+//
@@ -0,0 +1,190 @@
+//
+//	Query.h
+//	=======
+//
+//	Report the complete known state of the mobile and
+//	accessory decoders, or the load statistics of the
+//	districts, back to a host computer.
+//
+
+#ifndef _QUERY_H_
+#define _QUERY_H_
+
+#include "Environment.h"
+#include "Parameters.h"
+#include "Configuration.h"
+#include "Task_Entry.h"
+#include "Signal.h"
+#include "Byte_Queue.h"
+#include "District.h"
+#include "TWI.h"
+
+//
+//	In response to a '[S]' command the following replies are
+//	streamed back to the host:
+//
+//		[S m a]			Header: m mobile and a accessory
+//					records follow.
+//		[S t s d fl fh]		Mobile t has speed s, direction d
+//					and functions F0-F15 (fl) and
+//					F16-F28 (fh) as bit maps.
+//		[A t s]			Accessory t is in state s.
+//
+//	In response to a '[D]' command the load statistics of each
+//	district are returned, two replies per district:
+//
+//		[D n p m c t0 t1 t2 t3 t4 t5 x r a]
+//		[H n h0 h1 h2 h3 h4 h5 h6 h7]
+//
+//	where n is the district number, p and m the peak and minimum
+//	readings since the last report, c the count of times the
+//	instant current limit was exceeded and t0-t5 the seconds
+//	spent in each district state.  x is the number of times the
+//	ADC ISR has tripped the driver off, r the longest time (in
+//	microseconds) the district took to respond to a trip, and a
+//	the current (in milliamps) calculated from the latest
+//	oversampled reading.  h0-h7 are the histogram of readings
+//	(each bucket covering 128 ADC values).  These are followed
+//	by one reply per reverser group in use:
+//
+//		[R g l w s f]
+//
+//	where g is the group number, l and w the latest and worst
+//	time (in microseconds) taken to resolve a polarity flip,
+//	and s and f the number of flips which did, and did not,
+//	clear the short.
+//
+//	In response to an '[I]' command the health of the TWI bus is
+//	returned, a header then one reply per device known:
+//
+//		[I u k w x]		The bus was busy u percent of the
+//					time since the last report, and has
+//					been recovered from k hangs, the
+//					worst taking w microseconds.  x
+//					transactions were with devices too
+//					many to have statistics kept.
+//		[T a s t b n o r v w]	Device a was (s=1) or was not (s=0)
+//					found by the start up scan, and has
+//					had t transactions moving b bytes
+//					with n NAcks, o time outs and r
+//					retries.  v and w are the average
+//					and worst time (in microseconds)
+//					spent in the queue.
+//
+//	Replies are sent as output queue space permits, so a large
+//	report does not block other firmware activity.
+//
+
+//
+//	Define the delay (in milliseconds) before retrying when
+//	there is no space in the output queue.
+//
+#ifndef QUERY_RETRY_PERIOD
+#define QUERY_RETRY_PERIOD	5
+#endif
+
+class Query : public Task_Entry {
+private:
+	//
+	//	The size of the largest reply.
+	//
+	static const byte	reply_size = 32;
+
+	//
+	//	The number of values in, and size of, a district
+	//	statistics reply and a district histogram reply.
+	//
+	static const byte	statistics_values = 7 + District::district_states;
+	static const byte	statistics_size = 8 + 6 * statistics_values;
+	static const byte	histogram_values = 1 + District::statistics_block::buckets;
+	static const byte	histogram_size = 8 + 6 * histogram_values;
+
+	//
+	//	The number of values in, and size of, a bus device reply.
+	//
+	static const byte	device_values = 1 + TWI::health_values;
+	static const byte	device_size = 8 + 6 * device_values;
+
+	//
+	//	Retry period.
+	//
+	static const byte	retry_period = QUERY_RETRY_PERIOD;
+
+	//
+	//	The stages of a report.
+	//
+	enum query_stage : byte {
+		stage_idle = 0,
+		stage_header,
+		stage_mobiles,
+		stage_accessories,
+		stage_districts,
+		stage_histogram,
+		stage_reversers,
+		stage_bus,
+		stage_devices
+	};
+
+	//
+	//	Where we are in the report, and where it is going.
+	//
+	query_stage	_stage;
+	byte		_index;
+	Byte_Queue_API	*_port;
+
+	//
+	//	The control signal used to schedule this object.
+	//
+	Signal		_flag;
+
+	//
+	//	Send the next reply, returning true if it has been sent
+	//	and false if there was no space.
+	//
+	bool next_reply( void );
+
+public:
+	//
+	//	Constructor.
+	//
+	Query( void );
+
+	//
+	//	Link into the task manager.
+	//
+	void initialise( void );
+
+	//
+	//	Start a report to the port supplied.  Returns false if
+	//	a report is already in progress.
+	//
+	bool start( Byte_Queue_API *port );
+
+	//
+	//	Start a district statistics report to the port supplied.
+	//	Returns false if a report is already in progress.
+	//
+	bool statistics( Byte_Queue_API *port );
+
+	//
+	//	Start a TWI bus health report to the port supplied.
+	//	Returns false if a report is already in progress.
+	//
+	bool bus( Byte_Queue_API *port );
+
+	//
+	//	The task entry point.
+	//
+	virtual void process( void );
+};
+
+//
+//	The query engine.
+//
+extern Query state_query;
+
+#endif
+
+//
+//	EOF
+//
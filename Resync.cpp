@@ -0,0 +1,119 @@
+//
+//	Resync.cpp
+//	==========
+//
+//	Restore the state of the mobile decoders after the power
+//	to a district has been restored.
+//
+
+#include "Resync.h"
+#include "Task.h"
+#include "Clock.h"
+#include "Errors.h"
+#include "DCC.h"
+#include "Function.h"
+#include "Code_Assurance.h"
+
+//
+//	Constructor.
+//
+Resync::Resync( void ) {
+	_active = false;
+	_index = 0;
+	_started = 0;
+	_completed = 0;
+}
+
+//
+//	Link into the task manager.
+//
+void Resync::initialise( void ) {
+	task_manager.add_task( this, &_flag );
+}
+
+//
+//	Schedule the next step after the given period.
+//
+void Resync::schedule( byte period ) {
+	if( !event_timer.delay_event( MSECS( period ), &_flag, false )) {
+		errors.log_error( EVENT_TIMER_QUEUE_FULL, period );
+		_flag.release();
+	}
+}
+
+//
+//	Power has been restored: (re)start the replay.  If a
+//	replay is already under way it starts again from the
+//	beginning once the settle period has passed again, so
+//	districts powered up in sequence cause one complete
+//	replay after the last of them has settled.
+//
+void Resync::start( void ) {
+	_index = 0;
+	_started = millis();
+	if( !_active ) {
+		_active = true;
+		schedule( settle_period );
+	}
+}
+
+//
+//	The task entry point: replay one decoder per call while
+//	there are transmission buffers to spare.
+//
+void Resync::process( void ) {
+	word	target;
+	byte	speed,
+		direction,
+		fn[ DCC_Constant::bit_map_array ];
+	dword	waited;
+
+	if( !_active ) return;
+	//
+	//	Has the district powered up most recently had time
+	//	to settle?  If not, wait out the rest of the period.
+	//
+	if(( waited = millis() - _started ) < settle_period ) {
+		schedule( (byte)( settle_period - waited ));
+		return;
+	}
+	//
+	//	Skip to the next record in use.
+	//
+	while(( _index < function_cache.records()) && !function_cache.fetch( _index, &target, &speed, &direction, fn )) _index++;
+	if( _index >= function_cache.records()) {
+		_active = false;
+		if( _completed < MAXIMUM_WORD ) _completed++;
+		return;
+	}
+	//
+	//	Room to send it?
+	//
+	if( dcc_generator.free_buffers() <= reserve_buffers ) {
+		schedule( retry_period );
+		return;
+	}
+	(void)dcc_generator.state_command( target, speed, direction, fn );
+	_index++;
+	//
+	//	Come straight back for the next one, but via the
+	//	task manager so others get their turn.
+	//
+	_flag.release();
+}
+
+//
+//	Return the number of replays completed.
+//
+word Resync::completed( void ) {
+	return( _completed );
+}
+
+//
+//	The resync engine.
+//
+Resync resync;
+
+//
+//	EOF
+//
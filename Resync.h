@@ -0,0 +1,131 @@
+//
+//	Resync.h
+//	========
+//
+//	Restore the state of the mobile decoders after the power
+//	to a district has been restored.
+//
+
+#ifndef _RESYNC_H_
+#define _RESYNC_H_
+
+#include "Environment.h"
+#include "Parameters.h"
+#include "Configuration.h"
+#include "Task_Entry.h"
+#include "Signal.h"
+
+//
+//	When a district is powered up (from cold or after a pause)
+//	the decoders on it have lost their speed and function
+//	settings.  The resync engine replays the known state of
+//	every mobile decoder in the function cache as a state
+//	command, so trains recover without waiting for the next
+//	user action.
+//
+//	Commands are only issued while the DCC generator has more
+//	than RESYNC_RESERVE_BUFFERS free transmission buffers, so
+//	the replay never fills the transmission table and new user
+//	commands are always accepted.  The replay takes at most one
+//	retry period per busy check plus one command per cache
+//	record.
+//
+
+//
+//	Define the delay (in milliseconds) after power is restored
+//	before the replay starts, allowing decoders to boot.
+//
+#ifndef RESYNC_SETTLE_PERIOD
+#define RESYNC_SETTLE_PERIOD	100
+#endif
+
+//
+//	Define the delay (in milliseconds) before retrying when
+//	there are not enough free transmission buffers.
+//
+#ifndef RESYNC_RETRY_PERIOD
+#define RESYNC_RETRY_PERIOD	10
+#endif
+
+//
+//	Define the number of transmission buffers left for other
+//	commands.
+//
+#ifndef RESYNC_RESERVE_BUFFERS
+#define RESYNC_RESERVE_BUFFERS	2
+#endif
+
+class Resync : public Task_Entry {
+private:
+	//
+	//	Timing and pacing parameters.
+	//
+	static const byte	settle_period = RESYNC_SETTLE_PERIOD;
+	static const byte	retry_period = RESYNC_RETRY_PERIOD;
+	static const byte	reserve_buffers = RESYNC_RESERVE_BUFFERS;
+
+	//
+	//	Is a replay under way, and the next cache record to
+	//	be replayed.
+	//
+	bool		_active;
+	byte		_index;
+
+	//
+	//	When (in milliseconds) the replay was last (re)started.
+	//
+	dword		_started;
+
+	//
+	//	The number of replays completed.
+	//
+	word		_completed;
+
+	//
+	//	The control signal used to schedule this object.
+	//
+	Signal		_flag;
+
+	//
+	//	Schedule the next step after the given period.
+	//
+	void schedule( byte period );
+
+public:
+	//
+	//	Constructor.
+	//
+	Resync( void );
+
+	//
+	//	Link into the task manager.
+	//
+	void initialise( void );
+
+	//
+	//	Power has been restored: (re)start the replay from the
+	//	beginning of the cache.
+	//
+	void start( void );
+
+	//
+	//	The task entry point.
+	//
+	virtual void process( void );
+
+	//
+	//	Return the number of replays completed.
+	//
+	word completed( void );
+};
+
+//
+//	The resync engine.
+//
+extern Resync resync;
+
+#endif
+
+//
+//	EOF
+//
@@ -0,0 +1,100 @@
+//
+//	Reverser.h
+//	==========
+//
+//	Define the auto-reverser group.  Districts which may be
+//	shorted against each other (the two sides of a reversing
+//	loop) share a group, and only one district in a group may
+//	try the polarity flip at a time.  Districts in different
+//	groups resolve their shorts independently.
+//
+
+#ifndef _REVERSER_H_
+#define _REVERSER_H_
+
+#include "Configuration.h"
+#include "Environment.h"
+#include "Gate.h"
+
+//
+//	Define the reverser group, a Gate which also times how
+//	long each polarity flip takes to be resolved.
+//
+class Reverser {
+private:
+	//
+	//	The lock for the group.
+	//
+	Gate		_gate;
+
+	//
+	//	When (in microseconds) the current flip started, and
+	//	the timing of the resolutions so far.
+	//
+	dword		_started;
+	word		_latest,
+			_worst,
+			_resolved,
+			_failed;
+
+public:
+	Reverser( void ) {
+		_started = 0;
+		_latest = 0;
+		_worst = 0;
+		_resolved = 0;
+		_failed = 0;
+	}
+
+	//
+	//	Try to claim the group for a polarity flip.
+	//
+	bool acquired( void ) {
+		if( !_gate.acquired()) return( false );
+		_started = micros();
+		return( true );
+	}
+
+	//
+	//	Release the group once the flip has been resolved,
+	//	indicating if the flip cleared the short.
+	//
+	void release( bool cleared ) {
+		dword	taken;
+
+		if(( taken = micros() - _started ) > MAXIMUM_WORD ) taken = MAXIMUM_WORD;
+		_latest = (word)taken;
+		if( _latest > _worst ) _worst = _latest;
+		if( cleared ) {
+			if( _resolved < MAXIMUM_WORD ) _resolved++;
+		}
+		else {
+			if( _failed < MAXIMUM_WORD ) _failed++;
+		}
+		_gate.release();
+	}
+
+	//
+	//	Return the latest and worst resolution times (in
+	//	microseconds) and the number of flips which did, and
+	//	did not, clear the short.
+	//
+	word latest( void ) {
+		return( _latest );
+	}
+	word worst( void ) {
+		return( _worst );
+	}
+	word resolved( void ) {
+		return( _resolved );
+	}
+	word failed( void ) {
+		return( _failed );
+	}
+};
+
+#endif
+
+//
+//	EOF
+//
@@ -12,6 +12,7 @@
 #include "Clock.h"
 
 #include "DCC.h"
+#include "ADC_Manager.h"
 
 //
 //	Call initialise to get the system going.
@@ -27,9 +28,10 @@ void Stats::initialise( void ) {
 //
 void Stats::process( void ) {
 	//
-	//	For the moment only the DCC stats are gather this way.
+	//	The DCC and ADC stats are gathered this way.
 	//
 	_packets_sent.add( dcc_generator.packets_sent());
+	_conversions.add( adc_manager.conversions());
 }
 
 
@@ -40,6 +42,14 @@ word Stats::packets_sent( void ) {
 	return( _packets_sent.read( STATS_AVERAGE_READINGS-1 ));
 }
 
+//
+//	Return the ADC conversions completed in the last
+//	time period.
+//
+word Stats::conversions( void ) {
+	return( _conversions.read( STATS_AVERAGE_READINGS-1 ));
+}
+
 //
 //	The stats object.
 //
@@ -41,7 +41,8 @@ private:
 	//
 	//	The internal stats we are keeping.
 	//
-	Average< STATS_AVERAGE_READINGS >	_packets_sent;
+	Average< STATS_AVERAGE_READINGS >	_packets_sent,
+						_conversions;
 
 	//
 	//	The control signal used to schedule this object.
@@ -64,6 +65,12 @@ public:
 	//	Return the packets set in the last time period.
 	//
 	word packets_sent( void );
+
+	//
+	//	Return the ADC conversions completed in the last
+	//	time period.
+	//
+	word conversions( void );
 };
 
 //
@@ -300,6 +300,100 @@ void TWI::reset_hardware( void ) {
 
 
 
+//
+//	void release_bus( byte clocks )
+//	-------------------------------
+//
+//	With the TWI hardware disabled, drive the clock line by
+//	hand to release a slave part way through sending a byte,
+//	then send a stop condition.  Both lines are only ever
+//	pulled low or released (to the pull-ups), never driven
+//	high.
+//
+void TWI::release_bus( byte clocks ) {
+	pinMode( SDA, INPUT_PULLUP );
+	while( clocks-- ) {
+		pinMode( SCL, OUTPUT );
+		digitalWrite( SCL, LOW );
+		delayMicroseconds( bus_clear_us );
+		pinMode( SCL, INPUT_PULLUP );
+		delayMicroseconds( bus_clear_us );
+	}
+	//
+	//	The stop condition: SDA rising while SCL is high.
+	//
+	pinMode( SCL, OUTPUT );
+	digitalWrite( SCL, LOW );
+	pinMode( SDA, OUTPUT );
+	digitalWrite( SDA, LOW );
+	delayMicroseconds( bus_clear_us );
+	pinMode( SCL, INPUT_PULLUP );
+	delayMicroseconds( bus_clear_us );
+	pinMode( SDA, INPUT_PULLUP );
+	delayMicroseconds( bus_clear_us );
+}
+
+//
+//	void recover( void )
+//	--------------------
+//
+//	Abandon the active transaction as timed out, clear and
+//	reset the bus, then resume the queue.  The time taken is
+//	bounded by the bus clear and the hardware reset delay.
+//
+void TWI::recover( void ) {
+	dword	started,
+		taken;
+
+	started = micros();
+	{
+		Critical	code;
+
+		//
+		//	Check again with the interrupt held off, as the
+		//	ISR may have moved a byte or handed an event to
+		//	the task since the watchdog looked.  If not, stop
+		//	the hardware (and its interrupts) so the pins can
+		//	be driven by hand and nothing more can happen to
+		//	the transaction being abandoned.
+		//
+		if( _event ||( _moved != _seen )) return;
+		TWCR = 0;
+		_engine = engine_idle;
+	}
+	release_bus( bus_clear_clocks );
+	reset_hardware();
+	TWCR = bit( TWIE ) | bit( TWEN );
+	//
+	//	Fail the transaction and move on to the next.
+	//
+	*( _active->result ) = error_timed_out;
+	_event = false;
+	next_action();
+	if( _active ) {
+		_event = true;
+		_flag.release();
+	}
+	//
+	//	Count it.
+	//
+	if( _recoveries < MAXIMUM_WORD ) _recoveries++;
+	if(( taken = micros() - started ) > MAXIMUM_WORD ) taken = MAXIMUM_WORD;
+	if( taken > _recovery_time ) _recovery_time = (word)taken;
+}
+
+//
+//	void watch( void )
+//	------------------
+//
+//	Start the next watchdog period if there is an active
+//	transaction and one is not already pending.
+//
+void TWI::watch( void ) {
+	if( _watchdog ||( _active == NIL( transaction ))) return;
+	_watchdog = event_timer.delay_event( MSECS( watchdog_period ), &_flag, false );
+}
+
 //
 //	void next_action( void )
 //	------------------------
@@ -308,6 +402,11 @@ void TWI::reset_hardware( void ) {
 //	a new one.
 //
 void TWI::next_action( void ) {
+	transaction	*look;
+	client_stats	*c;
+	dword		now;
+
+	now = micros();
 	//
 	//	Are we replacing a now finished job?
 	//
@@ -315,34 +414,134 @@ void TWI::next_action( void ) {
 		//
 		//	Tell creator action has completed.
 		//
+		_busy += now - _started;
+		note_result( _active );
 		_active->flag->release();
 		//
-		//	Then return to queue.
+		//	Then return the record to the pool.
 		//
+		_active->flag = NIL( Signal );
+		_active = NIL( transaction );
 		_queue_len -= 1;
-		if(( _queue_out += 1 ) >= maximum_queue ) _queue_out = 0;
 	}
 	//
 	//	Is there anything left in the queue?
 	//
 	if( _queue_len ) {
 		//
-		//	Yes.
+		//	Yes.  Select the record with the highest priority,
+		//	then preferring a client other than the one just
+		//	served, and then the one which has waited longest.
 		//
-		_active = &( _queue[ _queue_out ]);
-	}
-	else {
+		for( byte i = 0; i < maximum_queue; i++ ) {
+			look = &( _queue[ i ]);
+			if( look->flag == NIL( Signal )) continue;
+			if( _active ) {
+				if( look->level != _active->level ) {
+					if( look->level < _active->level ) continue;
+				}
+				else if(( look->target == _last_target ) != ( _active->target == _last_target )) {
+					if( look->target == _last_target ) continue;
+				}
+				else if(( now - look->queued ) <= ( now - _active->queued )) {
+					continue;
+				}
+			}
+			_active = look;
+		}
+		_last_target = _active->target;
+		_started = now;
+		_progress = millis();
 		//
-		//	No.
+		//	Note how long it waited.
 		//
-		_active = NIL( transaction );
+		if(( c = add_client( _active->target ))) {
+			now -= _active->queued;
+			if( c->count < MAXIMUM_WORD ) {
+				c->count++;
+				c->waited += now;
+			}
+			if( now > c->worst ) c->worst = ( now > MAXIMUM_WORD )? MAXIMUM_WORD: (word)now;
+		}
 	}
 }
 
+//
+//	client_stats *find_client( byte adrs )
+//	--------------------------------------
+//
+//	Return the statistics record for the client at the
+//	address given, or NIL if it has none (or a scan is
+//	running).
+//
+TWI::client_stats *TWI::find_client( byte adrs ) {
+	if( _scanning ) return( NIL( client_stats ));
+	for( byte i = 0; i < maximum_clients; i++ ) if( _client[ i ].adrs == adrs ) return( &( _client[ i ]));
+	return( NIL( client_stats ));
+}
+
+//
+//	client_stats *add_client( byte adrs )
+//	-------------------------------------
+//
+//	As find_client(), but allocating a free record if the
+//	client has none, or NIL if the table is full.
+//
+TWI::client_stats *TWI::add_client( byte adrs ) {
+	client_stats	*c;
+
+	if( _scanning ) return( NIL( client_stats ));
+	for( byte i = 0; i < maximum_clients; i++ ) {
+		c = &( _client[ i ]);
+		if( c->adrs == 0 ) c->adrs = adrs;
+		if( c->adrs == adrs ) return( c );
+	}
+	return( NIL( client_stats ));
+}
 
 //
-//	bool queue_transaction( const machine_state *action, byte address, byte *buffer, byte send, byte recv, bool *flag, error_code *result )
-//	------------------------------------------------------------------------------------------------------------------------------------------
+//	void note_result( transaction *ptr )
+//	------------------------------------
+//
+//	Add the outcome of a finished transaction to the
+//	statistics of its client.
+//
+void TWI::note_result( transaction *ptr ) {
+	client_stats	*c;
+	word		n;
+
+	if(!( c = find_client( ptr->target ))) {
+		if( !_scanning &&( _untracked < MAXIMUM_WORD )) _untracked++;
+		return;
+	}
+	switch( *( ptr->result )) {
+		case error_none: {
+			n = ptr->send + ptr->recv;
+			break;
+		}
+		case error_address:
+		case error_write_fail: {
+			if( c->nacks < MAXIMUM_WORD ) c->nacks++;
+			n = ptr->next;
+			break;
+		}
+		case error_timed_out: {
+			if( c->timeouts < MAXIMUM_WORD ) c->timeouts++;
+			n = ptr->next;
+			break;
+		}
+		default: {
+			n = ptr->next;
+			break;
+		}
+	}
+	c->bytes = (( MAXIMUM_WORD - c->bytes ) < n )? MAXIMUM_WORD: ( c->bytes + n );
+}
+
+
+//
+//	bool queue_transaction( const machine_state *action, byte address, byte *buffer, byte send, byte recv, Signal *flag, error_code *result, priority level )
+//	--------------------------------------------------------------------------------------------------------------------------------------------------------
 //
 //	Initiates an asynchronous data exchange with a specified slave device, with the parameters supplying
 //	the required details:
@@ -354,6 +553,7 @@ void TWI::next_action( void ) {
 //		recv		The number of bytes which will be returned into the buffer area
 //		flag		Address of a flag to set to true when the command completes
 //		result		Address of an error_code variable where the status of the completed command is placed
+//		level		The priority of the exchange
 //
 //	Returns true if the exchange has been successfully queued, false otherwise.
 //
@@ -371,22 +571,27 @@ void TWI::next_action( void ) {
 //	must be prepared for this possibility as the same situation would apply with any
 //	size queue which has been filled with pending requests.
 //
-bool TWI::queue_transaction( const TWI::machine_state *action, byte adrs, byte *buffer, byte send, byte recv, Signal *flag, TWI::error_code *result ) {
+bool TWI::queue_transaction( const TWI::machine_state *action, byte adrs, byte *buffer, byte send, byte recv, Signal *flag, TWI::error_code *result, TWI::priority level ) {
 	transaction	*ptr;
 
 	ASSERT( flag != NIL( Signal ));
 	ASSERT( result != NIL( error_code ));
 
 	//
-	//	Is there space for a new request?
+	//	Is there space for a new request?  The last space is
+	//	only available to input devices.
 	//
-	if( _queue_len >= maximum_queue ) return( false );
+	if( _queue_len >= (( level == priority_input )? maximum_queue: ( maximum_queue - 1 ))) {
+		client_stats	*c;
+
+		if(( c = find_client( adrs ))&&( c->retries < MAXIMUM_WORD )) c->retries++;
+		return( false );
+	}
 	//
-	//	Locate the next available slot and adjust queue
-	//	appropriately.
+	//	Locate an available record.
 	//
-	ptr = &( _queue[ _queue_in++ ]);
-	if( _queue_in >= maximum_queue ) _queue_in = 0;
+	ptr = _queue;
+	while( ptr->flag != NIL( Signal )) ptr++;
 	//
 	//	"ptr" is the address of our queue record, so we can now
 	//	fill in this record with the supplied details.
@@ -399,12 +604,21 @@ bool TWI::queue_transaction( const TWI::machine_state *action, byte adrs, byte *
 	ptr->recv = recv;
 	ptr->flag = flag;
 	ptr->result = result;
+	ptr->level = level;
+	ptr->queued = micros();
+	*result = error_none;
 	//
-	//	Last action; increase the queue length and (if this is
-	//	the only item in the queue) release the flag to begin
-	//	the asynchronous processing.
+	//	Last action; increase the queue length and (if nothing is
+	//	in progress) select this record and release the flag to
+	//	begin the asynchronous processing.
 	//
-	if(( _queue_len += 1 ) == 1 ) _flag.release();
+	_queue_len += 1;
+	if( _active == NIL( transaction )) {
+		next_action();
+		_event = true;
+		_flag.release();
+	}
+	watch();
 	//
 	//	Good to go!
 	//
@@ -499,13 +713,41 @@ TWI::TWI( void ) {
 	//	Prepare the queue as empty.
 	//
 	_queue_len = 0;
-	_queue_in = 0;
-	_queue_out = 0;
+	for( byte i = 0; i < maximum_queue; _queue[ i++ ].flag = NIL( Signal ));
+	_last_target = 0;
 
 	//
 	//	Initially there is no active exchange.
 	//
 	_active = NIL( transaction );
+	_engine = engine_idle;
+	_event = false;
+	_watchdog = false;
+	_progress = 0;
+	_moved = 0;
+	_seen = 0;
+	_recoveries = 0;
+	_recovery_time = 0;
+
+	//
+	//	Clear the statistics.
+	//
+	for( byte i = 0; i < maximum_clients; i++ ) {
+		_client[ i ].adrs = 0;
+		_client[ i ].count = 0;
+		_client[ i ].bytes = 0;
+		_client[ i ].nacks = 0;
+		_client[ i ].timeouts = 0;
+		_client[ i ].retries = 0;
+		_client[ i ].worst = 0;
+		_client[ i ].waited = 0;
+	}
+	_untracked = 0;
+	for( byte i = 0; i < 16; _present[ i++ ] = 0 );
+	_scanning = false;
+	_started = 0;
+	_busy = 0;
+	_since = 0;
 
 	//
 	//	Disable slave configuration
@@ -540,12 +782,12 @@ TWI::TWI( void ) {
 //	The (6.5.1) Quick Commands
 //	--------------------------
 //
-bool TWI::quick_read( byte adrs, Signal *flag, TWI::error_code *result ) {
-	return( queue_transaction( mode_quick_read, adrs, NULL, 0, 0, flag, result ));
+bool TWI::quick_read( byte adrs, Signal *flag, TWI::error_code *result, TWI::priority level ) {
+	return( queue_transaction( mode_quick_read, adrs, NULL, 0, 0, flag, result, level ));
 }
 
-bool TWI::quick_write( byte adrs, Signal *flag, error_code *result ) {
-	return( queue_transaction( mode_quick_write, adrs, NULL, 0, 0, flag, result ));
+bool TWI::quick_write( byte adrs, Signal *flag, error_code *result, priority level ) {
+	return( queue_transaction( mode_quick_write, adrs, NULL, 0, 0, flag, result, level ));
 }
 
 //
@@ -557,16 +799,16 @@ bool TWI::quick_write( byte adrs, Signal *flag, error_code *result ) {
 //	(6.5.10) Write 32 protocol
 //	(6.5.12) Write 64 protocol
 //
-bool TWI::send_data( byte adrs, byte *buffer, byte send, Signal *flag, error_code *result ) {
-	return( queue_transaction( mode_send_data, adrs, buffer, send, 0, flag, result ));
+bool TWI::send_data( byte adrs, byte *buffer, byte send, Signal *flag, error_code *result, priority level ) {
+	return( queue_transaction( mode_send_data, adrs, buffer, send, 0, flag, result, level ));
 }
 
 //
 //	The (6.5.3) Receive Byte
 //	------------------------
 //
-bool TWI::receive_byte( byte adrs, byte *buffer, Signal *flag, error_code *result ) {
-	return( queue_transaction( mode_receive_byte, adrs, buffer, 0, 1, flag, result ));
+bool TWI::receive_byte( byte adrs, byte *buffer, Signal *flag, error_code *result, priority level ) {
+	return( queue_transaction( mode_receive_byte, adrs, buffer, 0, 1, flag, result, level ));
 }
 
 //
@@ -580,8 +822,8 @@ bool TWI::receive_byte( byte adrs, byte *buffer, Signal *flag, error_code *resul
 //	(6.5.11) Read 32 protocol
 //	(6.5.13) Read 64 protocol
 //
-bool TWI::exchange( byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result ) {
-	return( queue_transaction( mode_data_exchange, adrs, buffer, send, recv, flag, result ));
+bool TWI::exchange( byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result, priority level ) {
+	return( queue_transaction( mode_data_exchange, adrs, buffer, send, recv, flag, result, level ));
 }
 
 
@@ -594,7 +836,28 @@ bool TWI::exchange( byte adrs, byte *buffer, byte send, byte recv, Signal *flag,
 //
 void TWI::process( void ) {
 	
-	ASSERT( _active != NIL( transaction ));
+	//
+	//	Is this the watchdog?  If the active transaction has
+	//	made no progress for too long, recover the bus.  Bytes
+	//	moved by the byte engine count as progress.  The
+	//	watchdog stops once the queue is empty.
+	//
+	if( !_event ) {
+		_watchdog = false;
+		if( _active == NIL( transaction )) return;
+		if( _moved != _seen ) {
+			_seen = _moved;
+			_progress = millis();
+		}
+		else if(( millis() - _progress ) >= (dword)watchdog_period * watchdog_limit ) {
+			recover();
+		}
+		watch();
+		return;
+	}
+	_event = false;
+	if( _active == NIL( transaction )) return;
+	_progress = millis();
 	
 	//
 	//	The purpose of this routine is to handle the new state
@@ -725,8 +988,10 @@ machine_loop:
 		}
 		case state_send_byte: {
 			//
-			//	We have to send a byte to the slave
+			//	We have to send a byte to the slave, the ISR
+			//	will send any following bytes.
 			//
+			_engine = engine_sending;
 			send_byte( _active->buffer[ _active->next++ ]);
 			_active->action++;
 			break;
@@ -775,8 +1040,10 @@ machine_loop:
 			//	Here we let the system know that we are
 			//	ready to receive another byte from the
 			//	slave and (through Ack/NAck) if this will
-			//	be the last byte.
+			//	be the last byte.  The ISR will receive all
+			//	but the last byte.
 			//
+			_engine = engine_receiving;
 			read_ack( _active->next < ( _active->recv-1 ));
 			_active->action++;
 			break;
@@ -832,7 +1099,8 @@ machine_loop:
 			//	another if one is queued.
 			//
 			next_action();
-			goto machine_loop;
+			if( _active ) goto machine_loop;
+			break;
 		}
 		default: {
 			//
@@ -860,12 +1128,143 @@ machine_loop:
 //	that a change in the TWI hardware state has taken
 //	place.
 //
+//	While the byte engine is running, each acknowledged byte
+//	is followed immediately by the next one, so the bus is not
+//	left idle waiting for the task manager to call process().
+//
 void TWI::process_event( void ) {
 	_twsr = TWSR & 0xf8;
+	//
+	//	Can the byte engine continue the transfer without
+	//	involving the task?
+	//
+	switch( _engine ) {
+		case engine_sending: {
+			if(( _twsr == TW_MT_DATA_ACK )&&( _active->next < _active->send )) {
+				send_byte( _active->buffer[ _active->next++ ]);
+				_moved++;
+				return;
+			}
+			break;
+		}
+		case engine_receiving: {
+			if(( _twsr == TW_MR_DATA_ACK )&&( _active->next < ( _active->recv-1 ))) {
+				_active->buffer[ _active->next++ ] = read_byte();
+				read_ack( _active->next < ( _active->recv-1 ));
+				_moved++;
+				return;
+			}
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+	//
+	//	No, hand the new state back to the task.
+	//
+	_engine = engine_idle;
+	_event = true;
 	_flag.release();
 }
 
 
+//
+//	Queue and bus statistics
+//	------------------------
+//
+byte TWI::utilisation( void ) {
+	dword	now,
+		elapsed,
+		busy;
+
+	now = micros();
+	elapsed = now - _since;
+	busy = _busy;
+	_since = now;
+	_busy = 0;
+	if(( elapsed /= 100 ) == 0 ) return( 0 );
+	if(( busy /= elapsed ) > 100 ) busy = 100;
+	return( (byte)busy );
+}
+
+bool TWI::health( byte adrs, word *value ) {
+	client_stats	*c;
+
+	c = NIL( client_stats );
+	for( byte i = 0; i < maximum_clients; i++ ) {
+		if( _client[ i ].adrs == adrs ) {
+			c = &( _client[ i ]);
+			break;
+		}
+	}
+	if(( c == NIL( client_stats ))&& !present( adrs )) return( false );
+	value[ 0 ] = present( adrs )? 1: 0;
+	if( c ) {
+		value[ 1 ] = c->count;
+		value[ 2 ] = c->bytes;
+		value[ 3 ] = c->nacks;
+		value[ 4 ] = c->timeouts;
+		value[ 5 ] = c->retries;
+		value[ 6 ] = c->count? (word)( c->waited / c->count ): 0;
+		value[ 7 ] = c->worst;
+	}
+	else {
+		for( byte i = 1; i < health_values; value[ i++ ] = 0 );
+	}
+	return( true );
+}
+
+word TWI::recoveries( void ) {
+	return( _recoveries );
+}
+
+word TWI::recovery_time( void ) {
+	return( _recovery_time );
+}
+
+word TWI::untracked( void ) {
+	return( _untracked );
+}
+
+//
+//	byte scan( void )
+//	-----------------
+//
+//	Find the devices attached to the bus.
+//
+byte TWI::scan( void ) {
+	Signal		wait;
+	error_code	result;
+	byte		found;
+
+	found = 0;
+	_scanning = true;
+	for( byte adrs = lowest_address; adrs <= Highest_address; adrs++ ) {
+		while( !quick_write( adrs, &wait, &result )) task_manager.pole_task();
+		while( !wait.acquire()) task_manager.pole_task();
+		if( result == error_none ) {
+			_present[ adrs >> 3 ] |= bit( adrs & 7 );
+			found++;
+		}
+		else {
+			_present[ adrs >> 3 ] &= ~bit( adrs & 7 );
+		}
+	}
+	_scanning = false;
+	//
+	//	Give the devices found the first claim on the
+	//	statistics table.
+	//
+	for( byte adrs = lowest_address; adrs <= Highest_address; adrs++ ) if( present( adrs )) (void)add_client( adrs );
+	return( found );
+}
+
+bool TWI::present( byte adrs ) {
+	if( adrs > Highest_address ) return( false );
+	return(( _present[ adrs >> 3 ] & bit( adrs & 7 )) != 0 );
+}
+
 //
 //	The TWI Object
 //	==============
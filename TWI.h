@@ -67,7 +67,27 @@
 //	of attached devices.
 //
 #ifndef TWI_MAX_QUEUE_LEN
-#define TWI_MAX_QUEUE_LEN	4
+#define TWI_MAX_QUEUE_LEN	8
+#endif
+
+//
+//	Define the period (in milliseconds) of the bus hang watchdog.
+//	A transaction which makes no progress for two consecutive
+//	periods is abandoned and the bus recovered.
+//
+#ifndef TWI_WATCHDOG_PERIOD
+#define TWI_WATCHDOG_PERIOD	20
+#endif
+
+//
+//	Define the number of distinct clients (target addresses)
+//	for which queue waiting statistics are kept.  The devices
+//	found by the start up scan are given these first, and any
+//	transactions with clients beyond this are counted (see
+//	TWI::untracked()).
+//
+#ifndef TWI_MAX_CLIENTS
+#define TWI_MAX_CLIENTS		4
 #endif
 
 //
@@ -291,16 +311,37 @@ public:
 	static const byte	reset_delay_us = 50;
 
 	//
-	//	Define the Lowest and Highest valid addresses.
+	//	Define the Lowest and Highest valid addresses, the
+	//	7-bit addresses left once those reserved by the I2C
+	//	specification (0x00-0x07 and 0x78-0x7F) are removed.
 	//
-	static const byte	lowest_address = 16;
-	static const byte	Highest_address = 127;
+	static const byte	lowest_address = 0x08;
+	static const byte	Highest_address = 0x77;
 	
 	//
 	//	Define the size of the pending queue implemented by these functions.
 	//
 	static const byte	maximum_queue = TWI_MAX_QUEUE_LEN;
 
+	//
+	//	The bus hang watchdog period (in milliseconds), the number
+	//	of periods without progress before a transaction is timed
+	//	out (a whole transaction, even one moving a full buffer
+	//	of bytes through the ISR, takes far less), and the clocks
+	//	(with their half period in microseconds) sent to release
+	//	a slave holding the data line low.
+	//
+	static const word	watchdog_period = TWI_WATCHDOG_PERIOD;
+	static const byte	watchdog_limit = 2;
+	static const byte	bus_clear_clocks = 9;
+	static const byte	bus_clear_us = 5;
+
+	//
+	//	Define the number of clients for which statistics are
+	//	kept.
+	//
+	static const byte	maximum_clients = TWI_MAX_CLIENTS;
+
 	//
 	//	Define the number of micro-seconds we pause operation
 	//	of the TWI device in the event of a hardware reset.
@@ -329,6 +370,18 @@ public:
 		error_dropped		//	Transaction was dropped before completion
 	};
 
+	//
+	//	The priority classes for transactions.  The pending
+	//	transaction with the highest priority is always started
+	//	next; between transactions of the same priority the
+	//	clients (target addresses) take turns.
+	//
+	enum priority : byte {
+		priority_display = 0,	//	Display refresh
+		priority_normal,	//	Default
+		priority_input		//	Input devices
+	};
+
 private:
 	//
 	//	Declare the data structure the TWI code relies upon.
@@ -480,15 +533,66 @@ private:
 		//	The address where the error code of action is placed.
 		//
 		error_code		*result;
+		//
+		//	The priority of the transaction and when (in
+		//	microseconds) it was queued.
+		//
+		priority		level;
+		dword			queued;
 	};
 
 	//
-	//	Define the pending exchange queue and indexes into it.
+	//	Define the pending exchange queue.  This is a pool of
+	//	records, with unused records having a NIL flag, from
+	//	which the next transaction is selected by priority.
 	//
 	transaction	_queue[ maximum_queue ];	// This is the queue
-	byte		_queue_len,			// number of queued exchanges
-			_queue_in,			// index of next free slot
-			_queue_out;			// index of next pending exchange
+	byte		_queue_len;			// number of queued exchanges
+
+	//
+	//	The target address of the last transaction started, used
+	//	to rotate between clients of the same priority.
+	//
+	byte		_last_target;
+
+	//
+	//	Queue and health statistics for each client, by target
+	//	address.  Counts stick at their maximum value.
+	//
+	struct client_stats {
+		byte			adrs;		// Target address (0 if unused)
+		word			count,		// Transactions started
+					bytes,		// Bytes transferred
+					nacks,		// Address or data NAck'd
+					timeouts,	// Transactions timed out
+					retries,	// Rejected as the queue was full
+					worst;		// Longest wait (us)
+		dword			waited;		// Total wait (us)
+	};
+	client_stats	_client[ maximum_clients ];
+
+	//
+	//	Transactions finished with clients which did not fit in
+	//	the table above.
+	//
+	word		_untracked;
+
+	//
+	//	The devices found by the bus scan (one bit per address),
+	//	and true while the scan is running (its transactions are
+	//	not included in the statistics).
+	//
+	byte		_present[ 16 ];
+	bool		_scanning;
+
+	//
+	//	Bus utilisation: when the active transaction started and
+	//	the total time (in microseconds) the bus has been in use,
+	//	along with when the measurement started.
+	//
+	dword		_started,
+			_busy,
+			_since;
 
 	//
 	//	The following pointer is used by the ISR
@@ -505,6 +609,45 @@ private:
 	Signal		_flag;
 	byte		_twsr;
 
+	//
+	//	The byte engine.  While a multi-byte transfer is under
+	//	way the ISR itself sends (or receives) each byte which
+	//	is acknowledged, and only hands back to the task at the
+	//	end of the transfer or on an error.  The engine is set
+	//	by the task immediately before it starts the first byte,
+	//	and cleared by the ISR when it hands back.
+	//
+	enum engine_mode : byte {
+		engine_idle,
+		engine_sending,
+		engine_receiving
+	};
+	volatile engine_mode	_engine;
+
+	//
+	//	The task is run both by the ISR (or the queue) and by
+	//	the watchdog timer.  _event is set when the state machine
+	//	has something to act upon, the remaining calls being the
+	//	watchdog.  _watchdog is set while a watchdog timer is
+	//	pending (it is only kept running while there is an active
+	//	transaction) and _progress is when (in milliseconds) the
+	//	active transaction last made progress.  The byte engine
+	//	moves bytes without the task, so counts them in _moved;
+	//	_seen is the count when the watchdog last looked.
+	//
+	volatile bool	_event;
+	bool		_watchdog;
+	dword		_progress;
+	volatile byte	_moved;
+	byte		_seen;
+
+	//
+	//	The number of bus recoveries, and the longest (in
+	//	microseconds) one took.
+	//
+	word		_recoveries,
+			_recovery_time;
+
 	//
 	//	The following TWI "primitive" operations are based on the
 	//	content of the document:
@@ -730,6 +873,34 @@ private:
 	//
 	static void reset_hardware( void );
 
+	//
+	//	void release_bus( byte clocks )
+	//	-------------------------------
+	//
+	//	With the TWI hardware disabled, drive the clock line
+	//	by hand to release a slave part way through sending a
+	//	byte, then send a stop condition.
+	//
+	static void release_bus( byte clocks );
+
+	//
+	//	void recover( void )
+	//	--------------------
+	//
+	//	Abandon the active transaction as timed out, clear and
+	//	reset the bus, then resume the queue.
+	//
+	void recover( void );
+
+	//
+	//	void watch( void )
+	//	------------------
+	//
+	//	Start the next watchdog period if there is an active
+	//	transaction and one is not already pending.
+	//
+	void watch( void );
+
 
 	//
 	//	void next_action( void )
@@ -740,10 +911,40 @@ private:
 	//
 	void next_action( void );
 
+	//
+	//	client_stats *find_client( byte adrs )
+	//	--------------------------------------
+	//
+	//	Return the statistics record for the client at the
+	//	address given, or NIL if it has none (or a scan is
+	//	running).
+	//
+	client_stats *find_client( byte adrs );
+
+	//
+	//	client_stats *add_client( byte adrs )
+	//	-------------------------------------
+	//
+	//	As find_client(), but allocating a free record if the
+	//	client has none.  Only the bus scan and the start of a
+	//	transaction do this, so a request which is refused (or
+	//	never reaches the bus) cannot take a record.
+	//
+	client_stats *add_client( byte adrs );
+
+	//
+	//	void note_result( transaction *ptr )
+	//	------------------------------------
+	//
+	//	Add the outcome of a finished transaction to the
+	//	statistics of its client.
+	//
+	void note_result( transaction *ptr );
+
 
 	//
-	//	bool queue_transaction( const machine_state *action, byte address, byte *buffer, byte send, byte recv, Signal *flag, error_code *result )
-	//	------------------------------------------------------------------------------------------------------------------------------------------
+	//	bool queue_transaction( const machine_state *action, byte address, byte *buffer, byte send, byte recv, Signal *flag, error_code *result, priority level )
+	//	--------------------------------------------------------------------------------------------------------------------------------------------------------
 	//
 	//	Initiates an asynchronous data exchange with a specified slave device, with the parameters supplying
 	//	the required details:
@@ -755,6 +956,7 @@ private:
 	//		recv		The number of bytes which will be returned into the buffer area
 	//		flag		Address of a flag to set to true when the command completes
 	//		result		Address of an error_code variable where the status of the completed command is placed
+	//		level		The priority of the exchange
 	//
 	//	Returns true if the exchange has been successfully queued, false otherwise.
 	//
@@ -772,7 +974,10 @@ private:
 	//	must be prepared for this possibility as the same situation would apply with any
 	//	size queue which has been filled with pending requests.
 	//
-	bool queue_transaction( const machine_state *action, byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result );
+	//	The last slot in the queue is kept for input devices, so a queue filled
+	//	with display traffic cannot lock them out.
+	//
+	bool queue_transaction( const machine_state *action, byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result, priority level );
 
 public:
 	//
@@ -825,9 +1030,9 @@ public:
 	//	The (6.5.1) Quick Commands
 	//	--------------------------
 	//
-	bool quick_read( byte adrs, Signal *flag, error_code *result );
+	bool quick_read( byte adrs, Signal *flag, error_code *result, priority level = priority_normal );
 
-	bool quick_write( byte adrs, Signal *flag, error_code *result );
+	bool quick_write( byte adrs, Signal *flag, error_code *result, priority level = priority_normal );
 
 	//
 	//	All "just send data" commands
@@ -838,13 +1043,13 @@ public:
 	//	(6.5.10) Write 32 protocol
 	//	(6.5.12) Write 64 protocol
 	//
-	bool send_data( byte adrs, byte *buffer, byte send, Signal *flag, error_code *result );
+	bool send_data( byte adrs, byte *buffer, byte send, Signal *flag, error_code *result, priority level = priority_normal );
 
 	//
 	//	The (6.5.3) Receive Byte
 	//	------------------------
 	//
-	bool receive_byte( byte adrs, byte *buffer, Signal *flag, error_code *result );
+	bool receive_byte( byte adrs, byte *buffer, Signal *flag, error_code *result, priority level = priority_normal );
 
 	//
 	//	All "exchange data" commands
@@ -857,7 +1062,7 @@ public:
 	//	(6.5.11) Read 32 protocol
 	//	(6.5.13) Read 64 protocol
 	//
-	bool exchange( byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result );
+	bool exchange( byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result, priority level = priority_normal );
 
 	//
 	//	void process( void )
@@ -874,9 +1079,62 @@ public:
 	//
 	//	This routine is called by the ISR to alert the driver
 	//	that a change in the TWI hardware state has taken
-	//	place.
+	//	place.  Acknowledged bytes in the middle of a transfer
+	//	are handled here directly.
 	//
 	void process_event( void );
+
+	//
+	//	Queue and bus statistics
+	//	------------------------
+	//
+	//	utilisation() returns the percentage of the time the bus
+	//	has been in use since the last call (which restarts the
+	//	measurement).
+	//
+	//	health() fills in the health_values statistics for the
+	//	device at the address given:
+	//
+	//		0	1 if found by the bus scan, 0 otherwise
+	//		1	Transactions
+	//		2	Bytes transferred
+	//		3	NAcks (address or data)
+	//		4	Time outs
+	//		5	Retries (rejected with the queue full)
+	//		6	Average wait in the queue (us)
+	//		7	Worst wait in the queue (us)
+	//
+	//	returning false if nothing is known about the address.
+	//
+	static const byte	health_values = 8;
+
+	byte utilisation( void );
+	bool health( byte adrs, word *value );
+
+	//
+	//	void scan( void )
+	//	-----------------
+	//
+	//	Find the devices attached to the bus by sending a quick
+	//	write to every valid address.  This blocks the firmware
+	//	until complete, so is called once during start up.
+	//	Returns the number of devices found.
+	//
+	byte scan( void );
+	bool present( byte adrs );
+
+	//
+	//	Return the number of bus recoveries made by the watchdog
+	//	and the longest time (in microseconds) one took.
+	//
+	word recoveries( void );
+	word recovery_time( void );
+
+	//
+	//	Return the number of transactions with clients for
+	//	which there was no room in the statistics table.
+	//
+	word untracked( void );
 };
 
 
@@ -19,6 +19,9 @@ TaskManager::TaskManager( void ) {
 		_free = &( _table[ i ]);
 	}
 	_depth = 0;
+	_polls = 0;
+	_idle = 0;
+	_last_idle = 0;
 }
 
 //
@@ -60,7 +63,13 @@ void TaskManager::pole_task( void ) {
 		//	The called process is responsible for claiming
 		//	the resource (or resources as appropriate).
 		//
-		if( t->trigger->acquire()) t->call->process();
+		_polls++;
+		if( t->trigger->acquire()) {
+			t->call->process();
+		}
+		else {
+			_idle++;
+		}
 		
 		//
 		//	Put on the back of the task list to await
@@ -124,6 +133,26 @@ bool TaskManager::add_task( Task_Entry *call, Signal *trigger ) {
 	return( true );
 }
 
+//
+//	Return the percentage (0-100) of task polls which found
+//	nothing to do since the last estimate, then restart the
+//	count.  With fewer than 100 polls counted the figure would
+//	mean nothing, so the last estimate is returned and the
+//	count carries on.
+//
+byte TaskManager::idle( void ) {
+	byte	pc;
+
+	if( _polls < 100 ) return( _last_idle );
+	//
+	//	Dividing down the polls (rather than multiplying
+	//	up the idle count) avoids any overflow.
+	//
+	pc = (byte)( _idle / ( _polls / 100 ));
+	_polls = 0;
+	_idle = 0;
+	return(( _last_idle = ( pc > 100 )? 100: pc ));
+}
 
 //
 //	define the task_manager itself.
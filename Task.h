@@ -80,6 +80,17 @@ private:
 	//
 	byte		_depth;
 
+	//
+	//	Activity accounting: the number of tasks polled and
+	//	how many of those polls found nothing to do.  Used to
+	//	give an estimate of how idle the firmware is.  The
+	//	last estimate made is kept to be returned again while
+	//	there are too few polls to make a new one.
+	//
+	dword		_polls,
+			_idle;
+	byte		_last_idle;
+
 public:
 	//
 	//	Constructor and Destructor.
@@ -102,6 +113,14 @@ public:
 	//	This is the access point where tasks are added to the system.
 	//
 	bool add_task( Task_Entry *call, Signal *trigger );
+
+	//
+	//	Return the percentage (0-100) of task polls which found
+	//	nothing to do since the last estimate, then restart the
+	//	count.  With too few polls to go on the last estimate
+	//	(initially 0) is returned again.
+	//
+	byte idle( void );
 };
 
 //
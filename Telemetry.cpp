@@ -0,0 +1,217 @@
+//
+//	Telemetry.cpp
+//	=============
+//
+//	Periodic reporting of the electrical and processing load
+//	of the controller to the host computer.
+//
+
+#include "Telemetry.h"
+#include "Task.h"
+#include "Clock.h"
+#include "Constants.h"
+#include "Protocol.h"
+#include "Errors.h"
+#include "Stats.h"
+#include "DCC.h"
+#include "Buffer.h"
+#include "Code_Assurance.h"
+
+//
+//	Constructor.
+//
+Telemetry::Telemetry( void ) {
+	_len = 0;
+	_check = 0;
+	_mode = report_off;
+	_valid = false;
+	_port = NIL( USART_IO );
+	_engine = NIL( Protocol );
+	_skipped = 0;
+}
+
+//
+//	Call initialise to get the system going with
+//	the reports sent to the given port, which is
+//	read by the given protocol engine.
+//
+void Telemetry::initialise( USART_IO *port, Protocol *engine ) {
+	word	period;
+
+	ASSERT( port != NIL( USART_IO ));
+	ASSERT( engine != NIL( Protocol ));
+
+	_port = port;
+	_engine = engine;
+	//
+	//	The period is a constant, so the timer is set
+	//	up once as a repeating event.  This is always
+	//	running, reports being turned on and off via
+	//	the DYNAMIC_LOAD_REPORTS constant.
+	//
+	if(( period = DYNAMIC_LOAD_PERIOD ) > maximum_period ) period = maximum_period;
+	task_manager.add_task( this, &_flag );
+	if( !event_timer.delay_event( MSECS( period ), &_flag, true )) errors.log_error( EVENT_TIMER_QUEUE_FULL, period );
+}
+
+//
+//	Frame construction routines.  In ASCII mode the values are
+//	collected and formatted as a reply once the report is
+//	complete.
+//
+void Telemetry::add_raw( byte b ) {
+	if( _len < binary_size ) {
+		_frame.binary[ _len++ ] = b;
+	}
+	else {
+		_valid = false;
+	}
+}
+
+void Telemetry::add_byte( byte b ) {
+	if( _mode == report_binary ) {
+		add_raw( b );
+		_check ^= b;
+	}
+	else {
+		add_word( b );
+	}
+}
+
+void Telemetry::add_word( word w ) {
+	if( _mode == report_binary ) {
+		add_raw( W_TO_L( w ));
+		_check ^= W_TO_L( w );
+		add_raw( W_TO_H( w ));
+		_check ^= W_TO_H( w );
+	}
+	else {
+		if( _len < frame_values ) {
+			_frame.value[ _len++ ] = w;
+		}
+		else {
+			_valid = false;
+		}
+	}
+}
+
+//
+//	The routine called once a period to send a report.
+//
+void Telemetry::process( void ) {
+	byte	idle;
+
+	//
+	//	The CPU idle figure is always collected so that
+	//	each report covers exactly one period.
+	//
+	idle = task_manager.idle();
+
+	//
+	//	Are reports enabled?
+	//
+	if(( _mode = DYNAMIC_LOAD_REPORTS ) == report_off ) return;
+
+	//
+	//	Frame header.
+	//
+	_len = 0;
+	_check = 0;
+	_valid = true;
+	if( _mode == report_binary ) {
+		add_raw( binary_sync );
+		add_raw( 0 );
+		add_raw( Protocol::telemetry );
+		_check ^= Protocol::telemetry;
+	}
+
+	//
+	//	Per district values.
+	//
+	add_byte( districts.count());
+	for( byte i = 0; i < districts.count(); i++ ) {
+		add_word( districts.reading( i ));
+		add_word( districts.average( i, District::short_average_value ));
+		add_word( districts.average( i, District::average_current_index ));
+		add_byte( districts.state( i ));
+	}
+
+	//
+	//	System values.
+	//
+	add_byte( dcc_generator.free_buffers());
+	add_word( stats.packets_sent());
+	add_word( errors.logged());
+	add_byte( idle );
+	add_word( _port->dropped());
+	add_word( _skipped );
+	add_word( _engine->frames());
+	add_word( _engine->rejected());
+	add_word( stats.conversions());
+
+	//
+	//	Frame trailer, and only send if the whole frame will
+	//	fit, a partial frame is worse than none at all.
+	//
+	if( _mode == report_binary ) {
+		_frame.binary[ 1 ] = _len - 2;
+		add_raw( _check );
+		if( !_valid ||( _port->space() < _len )) {
+			if( _skipped < MAXIMUM_WORD ) _skipped++;
+			return;
+		}
+		for( byte i = 0; i < _len; _port->write( _frame.binary[ i++ ]));
+	}
+	else {
+		Buffer< text_size >	report;
+
+		if( !_valid ||!report.format( Protocol::telemetry, _len, _frame.value )||( _port->space() < report.size())) {
+			if( _skipped < MAXIMUM_WORD ) _skipped++;
+			return;
+		}
+		(void)report.send( _port );
+	}
+}
+
+//
+//	Send a district occupancy change event.  As with the
+//	reports, an event which does not fit is skipped.
+//
+void Telemetry::occupancy( byte district, bool occupied ) {
+	byte	mode;
+
+	if(( _port == NIL( USART_IO ))||(( mode = DYNAMIC_LOAD_REPORTS ) == report_off )) return;
+	if( mode == report_binary ) {
+		byte	event[ 6 ];
+
+		event[ 0 ] = binary_sync;
+		event[ 1 ] = 3;
+		event[ 2 ] = Protocol::occupancy;
+		event[ 3 ] = district;
+		event[ 4 ] = occupied? 1: 0;
+		event[ 5 ] = event[ 2 ] ^ event[ 3 ] ^ event[ 4 ];
+		if( _port->space() < sizeof( event )) {
+			if( _skipped < MAXIMUM_WORD ) _skipped++;
+			return;
+		}
+		for( byte i = 0; i < sizeof( event ); _port->write( event[ i++ ]));
+	}
+	else {
+		Buffer< 16 >	event;
+
+		if( !event.format( Protocol::occupancy, district, occupied? 1: 0 )||( _port->space() < event.size())) {
+			if( _skipped < MAXIMUM_WORD ) _skipped++;
+			return;
+		}
+		(void)event.send( _port );
+	}
+}
+
+//
+//	The telemetry object.
+//
+Telemetry telemetry;
+
+//
+//	EOF
+//
@@ -0,0 +1,168 @@
+//
+//	Telemetry.h
+//	===========
+//
+//	Periodic reporting of the electrical and processing load
+//	of the controller to the host computer.
+//
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include "Environment.h"
+#include "Parameters.h"
+#include "Configuration.h"
+#include "Task_Entry.h"
+#include "Signal.h"
+#include "USART.h"
+#include "Districts.h"
+#include "Protocol.h"
+
+//
+//	The telemetry frame is emitted every DYNAMIC_LOAD_PERIOD
+//	milliseconds when enabled by the DYNAMIC_LOAD_REPORTS
+//	constant:
+//
+//		0	Reports off.
+//		1	ASCII reports.
+//		2	Binary reports.
+//
+//	The ASCII rendering is a normal protocol reply:
+//
+//		[L n {r s a z}* f p e i d k c j v]
+//
+//	where n is the number of districts, and for each district
+//	r is the last ADC reading, s the short average, a the
+//	long average and z the district state.  These are followed
+//	by f the free DCC transmission buffers, p the packets sent,
+//	e the count of logged errors, i the percentage CPU idle,
+//	d the number of input bytes dropped on the port the
+//	telemetry is sent to, k the number of reports (and events)
+//	skipped for lack of output space, and c and j the number of
+//	packets parsed and rejected by the protocol engine reading
+//	that port.  v is the number of ADC conversions completed
+//	in the last statistics period (as gathered by Stats, which
+//	is the only reader of the ADC manager's count).
+//
+//	The binary frame carries the same values, in the same order,
+//	with byte values (n, z, f, i) as one byte and all others as
+//	two bytes (low byte first):
+//
+//		sync, length, 'L', values.., checksum
+//
+//	length counts the bytes from the 'L' to the last value and
+//	checksum is the exclusive or of those same bytes.
+//
+//	Between reports, district occupancy changes are sent as
+//	they are detected, in the same mode:
+//
+//		[O d s]				(ASCII)
+//		sync, 3, 'O', d, s, checksum	(binary)
+//
+//	where d is the district and s is 1 for occupied, 0 for free.
+//
+class Telemetry : public Task_Entry {
+public:
+	//
+	//	Reporting modes.
+	//
+	static const byte	report_off = 0;
+	static const byte	report_ascii = 1;
+	static const byte	report_binary = 2;
+
+	//
+	//	The binary frame lead in byte (chosen to be outside
+	//	the ASCII protocol character set).
+	//
+	static const byte	binary_sync = 0xA5;
+
+	//
+	//	The longest period (in milliseconds) which the event
+	//	timer can support.
+	//
+	static const word	maximum_period = 3000;
+
+private:
+	//
+	//	The number of byte and word values in a report, and the
+	//	sizes of the binary frame and of the ASCII rendering (up
+	//	to four characters for a byte value and six for a word).
+	//
+	static const byte	frame_bytes = 3 + Districts::maximum_districts;
+	static const byte	frame_words = 7 + 3 * Districts::maximum_districts;
+	static const byte	frame_values = frame_bytes + frame_words;
+	static const byte	binary_size = 4 + frame_bytes + 2 * frame_words;
+	static const byte	text_size = 8 + 4 * frame_bytes + 6 * frame_words;
+
+	//
+	//	The report under construction: the binary frame itself,
+	//	or the values to be formatted as an ASCII reply.
+	//
+	union {
+		byte	binary[ binary_size ];
+		word	value[ frame_values ];
+	}		_frame;
+	byte		_len,
+			_check,
+			_mode;
+	bool		_valid;
+
+	//
+	//	Where the telemetry is sent, and the protocol engine
+	//	reading from the same port.
+	//
+	USART_IO	*_port;
+	Protocol	*_engine;
+
+	//
+	//	Number of reports abandoned because the output
+	//	queue did not have space for them.
+	//
+	word		_skipped;
+
+	//
+	//	The control signal used to schedule this object.
+	//
+	Signal		_flag;
+
+	//
+	//	Frame construction routines.
+	//
+	void add_raw( byte b );
+	void add_byte( byte b );
+	void add_word( word w );
+
+public:
+	//
+	//	Constructor.
+	//
+	Telemetry( void );
+
+	//
+	//	Call initialise to get the system going with
+	//	the reports sent to the given port, which is
+	//	read by the given protocol engine.
+	//
+	void initialise( USART_IO *port, Protocol *engine );
+
+	//
+	//	The routine called once a period to send a report.
+	//
+	virtual void process( void );
+
+	//
+	//	Send a district occupancy change event.
+	//
+	void occupancy( byte district, bool occupied );
+};
+
+//
+//	The telemetry object.
+//
+extern Telemetry telemetry;
+
+#endif
+
+//
+//	EOF
+//
@@ -317,6 +317,12 @@ USART_IO::USART_IO( void ) {
 	_input = NULL;
 	_output = NULL;
 	_async = false;
+	_flow = FCNone;
+	_high_water = 0;
+	_low_water = 0;
+	_stopped = false;
+	_control = EOS;
+	_dropped = 0;
 }
 
 //
@@ -356,6 +362,15 @@ bool USART_IO::initialise( byte inst, USART_line_speed speed, USART_char_size bi
 	//
 	_async = false;
 
+	//
+	//	No flow control until asked for, and nothing
+	//	lost yet.
+	//
+	_flow = FCNone;
+	_stopped = false;
+	_control = EOS;
+	_dropped = 0;
+
 	//
 	//	Attach this object to the interrupts.
 	//
@@ -367,6 +382,126 @@ bool USART_IO::initialise( byte inst, USART_line_speed speed, USART_char_size bi
 	return( true );
 }
 
+//
+//	bool flow_control( USART_flow_control mode, byte high, byte low, byte rts )
+//	---------------------------------------------------------------------------
+//
+//	Enable receive flow control.  The remote end is told
+//	to stop when the input queue holds high or more
+//	bytes, and to resume once it has drained to low or
+//	fewer.
+//
+bool USART_IO::flow_control( USART_flow_control mode, byte high, byte low, byte rts ) {
+
+	ASSERT( low < high );
+
+	Critical code;
+
+	switch( mode ) {
+		case FCRtsCts: {
+			//
+			//	RTS is active low: drive it low so the
+			//	remote end may start sending.
+			//
+			if( !_rts.configure( rts, false )) return( false );
+			_rts.low();
+			break;
+		}
+		case FCXonXoff:
+		case FCNone: {
+			break;
+		}
+		default: {
+			return( false );
+		}
+	}
+	_flow = mode;
+	_high_water = high;
+	_low_water = low;
+	_stopped = false;
+	_control = EOS;
+	return( true );
+}
+
+//
+//	word dropped( void )
+//	--------------------
+//
+//	Return the number of input bytes lost since the
+//	interface was initialised.
+//
+word USART_IO::dropped( void ) {
+	Critical code;
+
+	return( _dropped );
+}
+
+//
+//	void stop_input( void )
+//	-----------------------
+//
+//	Ask the remote end to stop sending.  Called from
+//	the receive interrupt.
+//
+void USART_IO::stop_input( void ) {
+	_stopped = true;
+	switch( _flow ) {
+		case FCXonXoff: {
+			//
+			//	Place the XOFF ahead of any queued output
+			//	and make sure the transmitter is running.
+			//
+			_control = XOFF;
+			if( !_async ) {
+				_async = true;
+				_dev->dre_irq( true );
+			}
+			break;
+		}
+		case FCRtsCts: {
+			_rts.high();
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
+//
+//	void resume_input( void )
+//	-------------------------
+//
+//	Tell the remote end it may send again.  Called
+//	from task level as the input queue is read.
+//
+void USART_IO::resume_input( void ) {
+	Critical code;
+
+	_stopped = false;
+	switch( _flow ) {
+		case FCXonXoff: {
+			//
+			//	If the XOFF has not yet gone out this
+			//	simply replaces it.
+			//
+			_control = XON;
+			if( !_async ) {
+				_async = true;
+				_dev->dre_irq( true );
+			}
+			break;
+		}
+		case FCRtsCts: {
+			_rts.low();
+			break;
+		}
+		default: {
+			break;
+		}
+	}
+}
+
 //
 //	The Byte Queue API
 //	==================
@@ -403,7 +538,15 @@ byte USART_IO::space( void ) {
 //	the nul byte, ascii 0x00, '\0'.
 //
 byte USART_IO::read( void ) {
-	return( _input->read());
+	byte	data;
+
+	data = _input->read();
+	//
+	//	If we have stopped the remote end and the queue
+	//	has now drained far enough, let it start again.
+	//
+	if( _stopped &&( _input->available() <= _low_water )) resume_input();
+	return( data );
 }
 
 //
@@ -452,11 +595,26 @@ bool USART_IO::write( byte data ) {
 //	==========
 //
 void USART_IO::input_ready( void ) { 
-	if( !_input->write( _dev->read())) errors.log_error( USART_IO_ERR_DROPPED, 0 );
+	if( !_input->write( _dev->read())) {
+		_dropped++;
+		errors.log_error( USART_IO_ERR_DROPPED, _dropped );
+	}
+	//
+	//	Apply flow control if the queue has reached the
+	//	high water mark.
+	//
+	if(( _flow != FCNone )&& !_stopped &&( _input->available() >= _high_water )) stop_input();
 }
 
 void USART_IO::output_ready( void ) {
-	if( _output->available()) {
+	if( _control != EOS ) {
+		//
+		//	Flow control characters jump the queue.
+		//
+		_dev->write( _control );
+		_control = EOS;
+	}
+	else if( _output->available()) {
 		//
 		//	We have data, so send it.
 		//
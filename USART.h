@@ -17,6 +17,7 @@
 #include "Parameters.h"
 #include "Configuration.h"
 #include "Byte_Queue.h"
+#include "Pin_IO.h"
 
 //////////////////////////////////////////////////////////
 //							//
@@ -44,6 +45,11 @@ typedef enum {
 	SBOne	= 1,
 	SBTwo	= 2
 } USART_stop_bits;
+typedef enum {
+	FCNone	= 0,
+	FCXonXoff = 1,
+	FCRtsCts = 2
+} USART_flow_control;
 
 //////////////////////////////////////////////////////////
 //							//
@@ -448,6 +454,36 @@ class USART_IO : public Byte_Queue_API {
 		//
 		volatile bool		_async;
 
+		//
+		//	Receive flow control.  When the input queue
+		//	fills to the high water mark the remote end is
+		//	asked to stop sending (XOFF or RTS raised), and
+		//	when it drains to the low water mark it is asked
+		//	to resume (XON or RTS lowered).
+		//
+		//	_control holds an XON/XOFF character which must be
+		//	sent ahead of anything in the output queue (0 if
+		//	nothing is pending).
+		//
+		USART_flow_control	_flow;
+		byte			_high_water,
+					_low_water;
+		volatile bool		_stopped;
+		volatile byte		_control;
+		Pin_IO			_rts;
+
+		//
+		//	Count of bytes received but discarded because
+		//	the input queue was full.
+		//
+		volatile word		_dropped;
+
+		//
+		//	Routines to signal stop/resume to the remote end.
+		//
+		void stop_input( void );
+		void resume_input( void );
+
 	public:
 		//
 		//	Define the initialiser.
@@ -459,6 +495,29 @@ class USART_IO : public Byte_Queue_API {
 		//
 		bool initialise( byte inst, USART_line_speed speed, USART_char_size bits, USART_data_parity parity, USART_stop_bits sbits, Byte_Queue_API *in_queue, Byte_Queue_API *out_queue );
 
+		//
+		//	bool flow_control( USART_flow_control mode, byte high, byte low, byte rts = ERROR_BYTE )
+		//	---------------------------------------------------------------------------------------
+		//
+		//	Enable receive flow control.  The remote end is told
+		//	to stop when the input queue holds high or more
+		//	bytes, and to resume once it has drained to low or
+		//	fewer.  For FCRtsCts the platform pin rts is driven
+		//	low to permit and high to stop transmission.
+		//
+		//	Returns true if the flow control has been set up.
+		//
+		bool flow_control( USART_flow_control mode, byte high, byte low, byte rts = ERROR_BYTE );
+
+		//
+		//	word dropped( void )
+		//	--------------------
+		//
+		//	Return the number of input bytes lost since the
+		//	interface was initialised.
+		//
+		word dropped( void );
+
 		//
 		//	The Byte Queue API
 		//	==================
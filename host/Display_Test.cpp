@@ -0,0 +1,268 @@
+//
+//	Display_Test.cpp
+//	================
+//
+//	Runs the LCD and FrameBuffer modules against the emulated
+//	display, checking what ends up on the screen, then times a
+//	set of redraws and single LCD actions.
+//
+//	All times are simulated (see Host.h and LCD_Emulator.h), so
+//	they give the bus and LCD cost of each action, not the CPU
+//	time spent on the Arduino.
+//
+//	Run with "bench" as the argument to print the timings.
+//
+
+#include "../Environment.h"
+#include "../Configuration.h"
+#include "../Task.h"
+#include "../Clock.h"
+#include "../Errors.h"
+#include "../LCD.h"
+#include "../FrameBuffer.h"
+#include "LCD_Emulator.h"
+
+//
+//	The display under test.
+//
+static LCD		lcd;
+static byte		frame[ LCD_FRAME_BUFFER ];
+static FrameBuffer	display;
+
+//
+//	Check handling.
+//
+static int failures = 0;
+
+#define CHECK(e)	do{ if(!(e)){ fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #e ); failures++; }}while(false)
+
+//
+//	Run until the display has been quiet for 10ms.
+//
+static void settle( void ) {
+	do {
+		host_run( 1000 );
+	} while( micros() < lcd_emulator.last() + 10000 );
+}
+
+//
+//	Compare the screen with four rows of text.
+//
+static bool screen( const char *r0, const char *r1, const char *r2, const char *r3 ) {
+	char	want[ LCD_DISPLAY_ROWS * ( LCD_DISPLAY_COLS + 1 ) + 1 ],
+		have[ LCD_DISPLAY_ROWS * ( LCD_DISPLAY_COLS + 1 ) + 1 ];
+
+	snprintf( want, sizeof( want ), "%-20s\n%-20s\n%-20s\n%-20s\n", r0, r1, r2, r3 );
+	lcd_emulator.render( have );
+	if( strcmp( want, have ) == 0 ) return( true );
+	fprintf( stderr, "want:\n%shave:\n%s", want, have );
+	return( false );
+}
+
+//
+//	The tests, each is run with and without busy flag polling.
+//	Each starts from a blank frame buffer.
+//
+static void blank( void ) {
+	display.clear();
+	settle();
+}
+
+static void test_initialise( void ) {
+	CHECK( lcd_emulator.four_bit());
+	CHECK( lcd_emulator.display());
+	CHECK( !lcd_emulator.cursor());
+	CHECK( !lcd_emulator.blink());
+	CHECK( lcd_emulator.backlight());
+	CHECK( screen( "", "", "", "" ));
+}
+
+static void test_text( void ) {
+	blank();
+	display.set_posn( 0, 0 );
+	display.write_str( "Hello" );
+	display.set_posn( 1, 3 );
+	display.write_str( "row one" );
+	display.set_posn( 2, 0 );
+	display.write_str( "row two" );
+	display.set_posn( 3, 15 );
+	display.write_str( "World" );
+	settle();
+	CHECK( screen( "Hello", "   row one", "row two", "               World" ));
+}
+
+static void test_wrap( void ) {
+	blank();
+	//
+	//	Text runs on from the end of one row to the start of
+	//	the next, and from the bottom back to the top.
+	//
+	display.set_posn( 0, 15 );
+	display.write_str( "abcdefgh" );
+	display.set_posn( 3, 17 );
+	display.write_str( "xyz123" );
+	settle();
+	CHECK( screen( "123            abcde", "fgh", "", "                 xyz" ));
+}
+
+static void test_gaps( void ) {
+	blank();
+	//
+	//	Dirty cells separated by clean ones, which the frame
+	//	buffer either re-writes or skips with a re-position.
+	//
+	display.set_posn( 1, 0 );
+	display.write_str( "a.b..c...d....e" );
+	settle();
+	display.set_posn( 1, 0 );
+	display.write_str( "A.B..C...D....E" );
+	settle();
+	CHECK( screen( "", "A.B..C...D....E", "", "" ));
+}
+
+static void test_full( void ) {
+	char	row[ LCD_DISPLAY_ROWS ][ LCD_DISPLAY_COLS + 1 ];
+
+	blank();
+	for( byte r = 0; r < LCD_DISPLAY_ROWS; r++ ) {
+		for( byte c = 0; c < LCD_DISPLAY_COLS; c++ ) row[ r ][ c ] = '0' + (( r * LCD_DISPLAY_COLS + c ) % 75 );
+		row[ r ][ LCD_DISPLAY_COLS ] = EOS;
+		display.set_posn( r, 0 );
+		display.write_str( row[ r ]);
+	}
+	settle();
+	CHECK( screen( row[ 0 ], row[ 1 ], row[ 2 ], row[ 3 ]));
+}
+
+static void test_clear( void ) {
+	display.set_posn( 2, 5 );
+	display.write_str( "something" );
+	settle();
+	blank();
+	CHECK( screen( "", "", "", "" ));
+}
+
+//
+//	A transaction the display does not acknowledge makes the LCD
+//	drop its queue and reset.  The frame buffer must then send
+//	the whole frame again from a known position, wherever the
+//	failure falls.  Run with polling off, as a failed status
+//	read would (correctly) turn it off.
+//
+static void test_failure( void ) {
+	byte	resets;
+
+	for( byte after = 0; after < 4; after++ ) {
+		blank();
+		resets = lcd.resets();
+		lcd_emulator.fail( after );
+		display.set_posn( 1, 4 );
+		display.write_str( "failure" );
+		display.set_posn( 3, 10 );
+		display.write_str( "recovered" );
+		settle();
+		CHECK( lcd.resets() == resets + 1 );
+		CHECK( screen( "", "    failure", "", "          recovered" ));
+	}
+}
+
+static void run_tests( bool poll ) {
+	dword	reads;
+
+	lcd.busy_flag( poll );
+	reads = lcd_emulator.status_reads();
+	test_text();
+	test_wrap();
+	test_gaps();
+	test_full();
+	test_clear();
+	CHECK( lcd.polling() == poll );
+	CHECK(( lcd_emulator.status_reads() > reads ) == poll );
+}
+
+//
+//	Redraw timings.
+//
+static void redraw( const char *name, byte row, byte col, byte width, byte height ) {
+	static char	fill = 'A';
+	dword		start, trans, bytes, bus;
+
+	start = micros();
+	trans = lcd_emulator.transactions();
+	bytes = lcd_emulator.bytes();
+	bus = lcd_emulator.bus_us();
+	for( byte r = row; r < row + height; r++ ) {
+		display.set_posn( r, col );
+		display.fill( fill, width );
+	}
+	if(( fill += 1 ) > 'Z' ) fill = 'A';
+	settle();
+	printf( "  %-22s %4lu transactions %5lu bytes %7luus bus %7luus elapsed\n",
+		name,
+		lcd_emulator.transactions() - trans,
+		lcd_emulator.bytes() - bytes,
+		lcd_emulator.bus_us() - bus,
+		lcd_emulator.last() - start );
+}
+
+//
+//	Time a single LCD action from being queued to its flag
+//	being released.
+//
+static dword action( bool slow ) {
+	Signal	done;
+	dword	start;
+
+	start = micros();
+	if( slow ) {
+		(void)lcd.home( &done );
+	}
+	else {
+		(void)lcd.position( 0, 0, &done );
+	}
+	while( !done.acquire()) task_manager.pole_task();
+	return( micros() - start );
+}
+
+static void run_bench( bool poll ) {
+	dword	fast, slow;
+
+	lcd.busy_flag( poll );
+	printf( "%s:\n", poll? "Busy flag polling": "Timed delays" );
+	redraw( "full redraw (80 cells)", 0, 0, LCD_DISPLAY_COLS, LCD_DISPLAY_ROWS );
+	redraw( "status column (6x4)", 0, LCD_DISPLAY_STATUS_COLUMN, LCD_DISPLAY_STATUS_WIDTH, LCD_DISPLAY_ROWS );
+	redraw( "single row (20 cells)", 2, 0, LCD_DISPLAY_COLS, 1 );
+	settle();
+	fast = action( false );
+	slow = action( true );
+	settle();
+	printf( "  %-22s %7luus\n  %-22s %7luus\n", "set position", fast, "home", slow );
+}
+
+int main( int argc, char *argv[] ) {
+	host_start();
+	lcd.initialise( LCD_DISPLAY_ADRS, LCD_DISPLAY_ROWS, LCD_DISPLAY_COLS );
+	display.initialise( &lcd, frame, LCD_FRAME_BUFFER, LCD_DISPLAY_ROWS, LCD_DISPLAY_COLS );
+	settle();
+	test_initialise();
+	run_tests( false );
+	run_tests( true );
+	lcd.busy_flag( false );
+	test_failure();
+	if(( argc > 1 )&&( strcmp( argv[ 1 ], "bench" ) == 0 )) {
+		run_bench( false );
+		run_bench( true );
+	}
+	CHECK( lcd_emulator.overruns() == 0 );
+	CHECK( errors.logged() == 0 );
+	if( failures ) {
+		fprintf( stderr, "%d checks failed\n", failures );
+		return( 1 );
+	}
+	printf( "All display tests passed\n" );
+	return( 0 );
+}
+
+//
+//	EOF
+//
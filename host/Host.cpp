@@ -0,0 +1,110 @@
+//
+//	Host.cpp
+//	========
+//
+//	The host side of the Arduino environment: the simulated
+//	clock, the AVR registers and the error logging.
+//
+
+#include "../Environment.h"
+#include "../Task.h"
+#include "../Clock.h"
+#include "../Errors.h"
+
+//
+//	The registers.
+//
+volatile byte	TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0;
+volatile byte	TWCR, TWDR, TWSR, TWBR, TWAR;
+
+//
+//	Simulated time, in microseconds.
+//
+static dword host_micros = 0;
+
+dword micros( void ) {
+	return( host_micros );
+}
+
+dword millis( void ) {
+	return( host_micros / 1000 );
+}
+
+void delayMicroseconds( word us ) {
+	host_micros += us;
+}
+
+//
+//	On the hardware the event timer is ticked by the timer
+//	interrupt.  Here a task, which is always ready, stands in
+//	for it, so the clock moves on by one tick each time round
+//	the task list (including while tasks wait in pole_task()).
+//
+class Host_Clock : public Task_Entry {
+private:
+	Signal		_flag;
+
+public:
+	void initialise( void ) {
+		_flag.release();
+		task_manager.add_task( this, &_flag );
+	}
+
+	virtual void process( void ) {
+		host_micros += CLOCK_TICK;
+		event_timer.tick();
+		_flag.release();
+	}
+};
+
+static Host_Clock host_clock;
+
+void host_start( void ) {
+	host_clock.initialise();
+}
+
+void host_run( dword us ) {
+	dword	until;
+
+	until = host_micros + us;
+	while( host_micros < until ) task_manager.pole_task();
+}
+
+//
+//	Errors are only counted, so that the tests can check how
+//	many were logged.
+//
+Errors::Errors( void ) {
+	_count = 0;
+	_in = 0;
+	_out = 0;
+	_logged = 0;
+}
+
+void Errors::initialise( void ) {
+}
+
+void Errors::process( void ) {
+}
+
+void Errors::drop_error( void ) {
+}
+
+void Errors::log_error( UNUSED( byte error ), UNUSED( word arg )) {
+	_logged++;
+}
+
+void Errors::log_terminate( word error, const char *file_name, word line_number ) {
+	fprintf( stderr, "terminate %u at %s:%u\n", error, file_name, line_number );
+	exit( 2 );
+}
+
+word Errors::logged( void ) {
+	return( _logged );
+}
+
+Errors errors;
+
+//
+//	EOF
+//
@@ -0,0 +1,96 @@
+//
+//	Host.h
+//	======
+//
+//	Forced in front of every firmware source compiled by the host
+//	build (see Makefile).  It provides just enough of the Arduino
+//	and AVR environment for the firmware modules it builds to
+//	compile and run under Linux.
+//
+//	The AVR registers touched by inline code in the firmware
+//	headers are declared as plain memory, and time is simulated:
+//	the Host_Clock task (see Host.cpp) advances micros() by one
+//	CLOCK_TICK and ticks the event timer every time it is run.
+//
+#ifndef _HOST_H_
+#define _HOST_H_
+
+//
+//	Compile as the Mega2560, the default target.
+//
+#ifndef __AVR_ATmega2560__
+#define __AVR_ATmega2560__
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#include "../Library_Types.h"
+
+//
+//	Arduino environment.
+//
+#define F_CPU		16000000UL
+#define bit(b)		(1UL<<(b))
+#define bitSet(v,b)	((v)|=bit(b))
+#define bitClear(v,b)	((v)&=~bit(b))
+#define bitWrite(v,b,s)	((s)?bitSet(v,b):bitClear(v,b))
+
+template< class T > inline T min( T a, T b ) { return(( a < b )? a: b ); }
+template< class T > inline T max( T a, T b ) { return(( a > b )? a: b ); }
+
+extern dword millis( void );
+extern dword micros( void );
+extern void delayMicroseconds( word us );
+
+#define memcpy_P	memcpy
+#define strlen_P	strlen
+
+//
+//	The simulated clock.  host_start() adds the task which steps
+//	it, host_run() then polls the tasks until the given number of
+//	microseconds have passed.
+//
+extern void host_start( void );
+extern void host_run( dword us );
+
+//
+//	Interrupt handlers become plain functions.
+//
+#define ISR(v)		void v( void )
+
+//
+//	Timer 0, as used by Clock.cpp.
+//
+extern volatile byte	TCCR0A, TCCR0B, TCNT0, OCR0A, TIMSK0;
+
+#define WGM01		1
+#define CS00		0
+#define CS01		1
+#define OCIE0A		1
+
+//
+//	The TWI registers and <util/twi.h> direction bits, as used
+//	by the inline code in TWI.h.
+//
+extern volatile byte	TWCR, TWDR, TWSR, TWBR, TWAR;
+
+#define TWINT		7
+#define TWEA		6
+#define TWSTA		5
+#define TWSTO		4
+#define TWWC		3
+#define TWEN		2
+#define TWIE		0
+
+#define TW_READ		1
+#define TW_WRITE	0
+
+#endif
+
+//
+//	EOF
+//
@@ -0,0 +1,301 @@
+//
+//	LCD_Emulator.cpp
+//	================
+//
+//	The PCF8574 and HD44780 model.
+//
+
+#include "LCD_Emulator.h"
+#include "../LCD.h"
+
+LCD_Emulator::LCD_Emulator( byte adrs, byte rows, byte cols ) {
+	_adrs = adrs;
+	_rows = rows;
+	_cols = cols;
+	reset();
+}
+
+void LCD_Emulator::reset( void ) {
+	//
+	//	Power on: 8-bit interface, one line, display off,
+	//	incrementing, and the expander pins all high.
+	//
+	_latch = 0xff;
+	_four_bit = false;
+	_two_lines = false;
+	_low = false;
+	_increment = true;
+	_scroll = false;
+	_display = false;
+	_cursor = false;
+	_blink = false;
+	_cgram = false;
+	_high = 0;
+	_ac = 0;
+	_cg = 0;
+	_shift = 0;
+	memset( _ddram, SPACE, ddram_size );
+	memset( _cgdata, 0, cgram_size );
+	_busy_until = 0;
+	_bus_free = 0;
+	_fail = 0;
+	_transactions = 0;
+	_bytes = 0;
+	_bus_us = 0;
+	_instructions = 0;
+	_characters = 0;
+	_status_reads = 0;
+	_overruns = 0;
+	_last = 0;
+}
+
+//
+//	With two lines the display memory is two runs of 40 bytes
+//	(at 0x00 and 0x40), with one it is a single run of 80.
+//
+byte LCD_Emulator::step( byte adrs, bool up ) {
+	if( _two_lines ) {
+		if( up ) {
+			adrs++;
+			if( adrs == 0x28 ) adrs = 0x40;
+			if( adrs >= 0x68 ) adrs = 0x00;
+		}
+		else {
+			if( adrs == 0x00 ) adrs = 0x67;
+			else if( adrs == 0x40 ) adrs = 0x27;
+			else adrs--;
+		}
+	}
+	else {
+		if( up ) {
+			if( ++adrs >= 0x50 ) adrs = 0x00;
+		}
+		else {
+			adrs = ( adrs == 0x00 )? 0x4f: ( adrs - 1 );
+		}
+	}
+	return( adrs );
+}
+
+void LCD_Emulator::execute( bool rs, byte value, dword at ) {
+	word	takes;
+
+	//
+	//	The controller ignores anything sent while it is busy.
+	//
+	if( at < _busy_until ) {
+		_overruns++;
+		return;
+	}
+	takes = fast_us;
+	if( rs ) {
+		//
+		//	Write data.
+		//
+		_characters++;
+		if( _cgram ) {
+			_cgdata[ _cg ] = value;
+			_cg = ( _increment? ( _cg + 1 ): ( _cg - 1 )) & ( cgram_size - 1 );
+		}
+		else {
+			_ddram[ _ac ] = value;
+			_ac = step( _ac, _increment );
+			if( _scroll ) _shift = ( _increment? ( _shift + 1 ): ( _shift + 39 )) % 40;
+		}
+	}
+	else {
+		//
+		//	Instructions, the highest bit set identifies
+		//	each one.
+		//
+		_instructions++;
+		if( value & 0x80 ) {			// Set DDRAM address
+			_ac = value & 0x7f;
+			_cgram = false;
+		}
+		else if( value & 0x40 ) {		// Set CGRAM address
+			_cg = value & 0x3f;
+			_cgram = true;
+		}
+		else if( value & 0x20 ) {		// Function set
+			_four_bit = !( value & 0x10 );
+			_two_lines = BOOL( value & 0x08 );
+		}
+		else if( value & 0x10 ) {		// Cursor or display shift
+			if( value & 0x08 ) {
+				_shift = ( value & 0x04 )? (( _shift + 39 ) % 40 ): (( _shift + 1 ) % 40 );
+			}
+			else {
+				_ac = step( _ac, BOOL( value & 0x04 ));
+			}
+		}
+		else if( value & 0x08 ) {		// Display control
+			_display = BOOL( value & 0x04 );
+			_cursor = BOOL( value & 0x02 );
+			_blink = BOOL( value & 0x01 );
+		}
+		else if( value & 0x04 ) {		// Entry mode
+			_increment = BOOL( value & 0x02 );
+			_scroll = BOOL( value & 0x01 );
+		}
+		else if( value & 0x02 ) {		// Return home
+			_ac = 0;
+			_shift = 0;
+			_cgram = false;
+			takes = slow_us;
+		}
+		else if( value & 0x01 ) {		// Clear display
+			memset( _ddram, SPACE, ddram_size );
+			_ac = 0;
+			_shift = 0;
+			_increment = true;
+			_cgram = false;
+			takes = slow_us;
+		}
+	}
+	_busy_until = at + takes;
+}
+
+void LCD_Emulator::latch( byte pins, dword at ) {
+	//
+	//	Only the falling edge of E does anything.
+	//
+	if(( _latch & pin_e )&&!( pins & pin_e )) {
+		if( pins & pin_rw ) {
+			//
+			//	The end of a read cycle, which (in 4-bit
+			//	mode) moves on to the other nybble.
+			//
+			if( _four_bit ) _low = !_low;
+		}
+		else if( !_four_bit ) {
+			//
+			//	8-bit mode, only D4-D7 are wired so the
+			//	low half of the instruction is zero.
+			//
+			execute( BOOL( pins & pin_rs ), pins & pin_data, at );
+		}
+		else if( _low ) {
+			execute( BOOL( pins & pin_rs ), _high | (( pins & pin_data ) >> 4 ), at );
+			_low = false;
+		}
+		else {
+			_high = pins & pin_data;
+			_low = true;
+		}
+	}
+	_latch = pins;
+}
+
+byte LCD_Emulator::pins( dword at ) {
+	byte	data;
+
+	//
+	//	The LCD only drives the data lines during a read
+	//	with E high, otherwise they read back as written.
+	//
+	if(( _latch & pin_e )&&( _latch & pin_rw )) {
+		if( _four_bit && _low ) {
+			data = ( _ac & 0x0f ) << 4;
+		}
+		else {
+			data = (( at < _busy_until )? 0x80: 0 )|( _ac & 0x70 );
+		}
+		return( data |( _latch & ~pin_data ));
+	}
+	return( _latch );
+}
+
+//
+//	Count down to a refused transaction, if one is set.
+//
+bool LCD_Emulator::refused( void ) {
+	return( _fail && ( --_fail == 0 ));
+}
+
+word LCD_Emulator::send_data( byte adrs, const byte *buffer, byte send, dword now ) {
+	dword	at;
+	word	us;
+
+	if(( adrs != _adrs )|| refused()) return( 0 );
+	//
+	//	Start, then the address byte, then each data byte
+	//	is applied once it has been clocked across.
+	//
+	at = max( now, _bus_free ) + bit_us + byte_us;
+	for( byte i = 0; i < send; i++ ) latch( buffer[ i ], at += byte_us );
+	us = ( 2 + 9 * ( 1 + send )) * bit_us;
+	_bus_free = max( now, _bus_free ) + us;
+	_last = _bus_free;
+	_transactions++;
+	_bytes += send;
+	_bus_us += us;
+	return( us );
+}
+
+word LCD_Emulator::exchange( byte adrs, byte *buffer, byte send, byte recv, dword now ) {
+	dword	at;
+	word	us;
+
+	if(( adrs != _adrs )|| refused()) return( 0 );
+	//
+	//	As send_data, then a repeated start and the address
+	//	byte again before the bytes are read back.
+	//
+	at = max( now, _bus_free ) + bit_us + byte_us;
+	for( byte i = 0; i < send; i++ ) latch( buffer[ i ], at += byte_us );
+	at += bit_us + byte_us;
+	for( byte i = 0; i < recv; i++ ) {
+		buffer[ i ] = pins( at );
+		at += byte_us;
+	}
+	if(( _latch & pin_e )&&( _latch & pin_rw )&&!( _latch & pin_rs )) _status_reads++;
+	us = ( 3 + 9 * ( 2 + send + recv )) * bit_us;
+	_bus_free = max( now, _bus_free ) + us;
+	_last = _bus_free;
+	_transactions++;
+	_bytes += send + recv;
+	_bus_us += us;
+	return( us );
+}
+
+byte LCD_Emulator::at( byte row, byte col ) {
+	byte	adrs;
+
+	//
+	//	Four line displays are two line displays folded in
+	//	half, so rows 2 and 3 continue rows 0 and 1.
+	//
+	if( _two_lines ) {
+		adrs = (( row & 1 )? 0x40: 0x00 ) + (( row >> 1 ) * _cols + col + _shift ) % 40;
+	}
+	else {
+		adrs = ( row * _cols + col + _shift ) % 80;
+	}
+	return( _ddram[ adrs ]);
+}
+
+char *LCD_Emulator::render( char *text ) {
+	char	*p;
+	byte	c;
+
+	p = text;
+	for( byte r = 0; r < _rows; r++ ) {
+		for( byte i = 0; i < _cols; i++ ) {
+			c = at( r, i );
+			*p++ = isprint( c )? c: '?';
+		}
+		*p++ = NL;
+	}
+	*p = EOS;
+	return( text );
+}
+
+//
+//	The display on the emulated bus.
+//
+LCD_Emulator lcd_emulator( LCD_DISPLAY_ADRS, LCD_DISPLAY_ROWS, LCD_DISPLAY_COLS );
+
+//
+//	EOF
+//
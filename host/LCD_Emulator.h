@@ -0,0 +1,194 @@
+//
+//	LCD_Emulator.h
+//	==============
+//
+//	A model of the PCF8574 I/O expander and HD44780 LCD controller
+//	which sit behind the display's TWI address.  The host build
+//	replaces the TWI module with calls into this model (see
+//	TWI_Emulator.cpp), so the LCD and FrameBuffer modules can be
+//	run, checked and timed without the hardware.
+//
+//	Every byte sent to the expander becomes the state of its
+//	pins (see "Output State" in LCD.h).  On each 1 -> 0 transition
+//	of E the data lines (D4-D7 of the LCD) are latched, paired
+//	into bytes once in 4-bit mode (high nybble first) and applied
+//	to the display memory (DDRAM) and address counter.
+//
+//	Time is the simulated micros() of the host build.  Each byte
+//	is given the time at which it leaves the bus, and each
+//	instruction or character keeps the controller busy for its
+//	datasheet execution time.  Anything which arrives while the
+//	controller is still busy is counted as an overrun and lost,
+//	as it would be on the hardware.
+//
+#ifndef _LCD_EMULATOR_H_
+#define _LCD_EMULATOR_H_
+
+#include "../Environment.h"
+#include "../TWI.h"
+
+class LCD_Emulator {
+public:
+	//
+	//	The bus timing, at 100KHz each bit takes 10us and each
+	//	byte (with its acknowledgement) nine bits.
+	//
+	static const word	bit_us = 1000 / ( TWI_FREQ * 10 );
+	static const word	byte_us = 9 * bit_us;
+
+	//
+	//	HD44780 execution times (us).
+	//
+	static const word	slow_us = 1520;		// Clear and Home
+	static const word	fast_us = 37;		// Everything else
+
+	//
+	//	Size of the display memory.
+	//
+	static const byte	ddram_size = 0x80;
+	static const byte	cgram_size = 0x40;
+
+private:
+	//
+	//	The expander pins, see "Output State" in LCD.h.
+	//
+	static const byte	pin_rs = 0x01;
+	static const byte	pin_rw = 0x02;
+	static const byte	pin_e = 0x04;
+	static const byte	pin_led = 0x08;
+	static const byte	pin_data = 0xf0;
+
+	byte		_adrs,			// TWI target address
+			_rows,			// Panel size
+			_cols,
+			_latch;			// Last byte written
+
+	//
+	//	The controller.
+	//
+	bool		_four_bit,		// DL = 0
+			_two_lines,		// N = 1
+			_low,			// Next nybble is the low one
+			_increment,		// I/D
+			_scroll,		// S
+			_display,		// D
+			_cursor,		// C
+			_blink,			// B
+			_cgram;			// Data goes to the CGRAM
+	byte		_high,			// Pending high nybble
+			_ac,			// DDRAM address counter
+			_cg,			// CGRAM address counter
+			_shift;			// Display shift (0..39)
+	byte		_ddram[ ddram_size ],
+			_cgdata[ cgram_size ];
+	dword		_busy_until,		// Controller busy until
+			_bus_free;		// Bus idle after
+	word		_fail;			// Transactions before a refusal
+
+	//
+	//	The counters.
+	//
+	dword		_transactions,
+			_bytes,
+			_bus_us,
+			_instructions,
+			_characters,
+			_status_reads,
+			_overruns,
+			_last;
+
+	//
+	//	Move the address counter one step in the current
+	//	direction.
+	//
+	byte step( byte adrs, bool up );
+
+	//
+	//	Apply a completed instruction or character.
+	//
+	void execute( bool rs, byte value, dword at );
+
+	//
+	//	Apply a byte written to the expander at the given time.
+	//
+	void latch( byte pins, dword at );
+
+	//
+	//	Return what the expander pins read back as at the given
+	//	time.
+	//
+	byte pins( dword at );
+
+	//
+	//	Return true if this transaction is to be refused.
+	//
+	bool refused( void );
+
+public:
+	//
+	//	Constructor, giving the target address and the size of
+	//	the panel, and power on reset.
+	//
+	LCD_Emulator( byte adrs, byte rows, byte cols );
+	void reset( void );
+
+	//
+	//	The TWI operations.  Both return the bus time (us) the
+	//	transaction takes, or zero if it is not addressed to
+	//	this device.
+	//
+	word send_data( byte adrs, const byte *buffer, byte send, dword now );
+	word exchange( byte adrs, byte *buffer, byte send, byte recv, dword now );
+
+	//
+	//	Let the given number of transactions through, then
+	//	refuse (do not acknowledge) the one after.
+	//
+	void fail( word after ) { _fail = after + 1; }
+
+	//
+	//	Copy the visible characters into text, one row per line
+	//	(each terminated with a new line), and return text.  The
+	//	buffer needs rows * ( cols + 1 ) + 1 bytes.
+	//
+	char *render( char *text );
+
+	//
+	//	Return the character in the display memory at a visible
+	//	position.
+	//
+	byte at( byte row, byte col );
+
+	//
+	//	Controller state.
+	//
+	bool four_bit( void ) { return( _four_bit ); }
+	bool display( void ) { return( _display ); }
+	bool cursor( void ) { return( _cursor ); }
+	bool blink( void ) { return( _blink ); }
+	bool backlight( void ) { return( BOOL( _latch & pin_led )); }
+	byte address_counter( void ) { return( _ac ); }
+
+	//
+	//	Counters, and the time the last transaction ends.
+	//
+	dword transactions( void ) { return( _transactions ); }
+	dword bytes( void ) { return( _bytes ); }
+	dword bus_us( void ) { return( _bus_us ); }
+	dword instructions( void ) { return( _instructions ); }
+	dword characters( void ) { return( _characters ); }
+	dword status_reads( void ) { return( _status_reads ); }
+	dword overruns( void ) { return( _overruns ); }
+	dword last( void ) { return( _last ); }
+};
+
+//
+//	The display on the emulated bus.
+//
+extern LCD_Emulator lcd_emulator;
+
+#endif
+
+//
+//	EOF
+//
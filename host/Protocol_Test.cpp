@@ -0,0 +1,309 @@
+//
+//	Protocol_Test.cpp
+//	=================
+//
+//	Drives Protocol::process() from an in-memory console, first
+//	with a corpus of valid and invalid packets, then with random
+//	byte streams, checking the packets parsed and rejected and
+//	that the parser always recovers.
+//
+//	Run with "bench" as the argument to print the parsing rate.
+//	This is host CPU time, so is only useful for comparing one
+//	version of the parser with another.
+//
+
+#include <time.h>
+
+#include "../Environment.h"
+#include "../Task.h"
+#include "../Errors.h"
+#include "../Byte_Queue.h"
+#include "../Protocol.h"
+#include "../Query.h"
+#include "../Districts.h"
+
+//
+//	Link stand-ins for the modules the commands are passed on
+//	to.  Only the calls made by Protocol.cpp are provided, and
+//	the queries simply count how often they are started.
+//
+static word	queries = 0;
+
+Pin_IO::Pin_IO( void ) {}
+
+District::District( void ) {}
+void District::process( void ) {}
+
+Districts::Districts( void ) {}
+void Districts::process( void ) {}
+byte Districts::count( void ) { return( 2 ); }
+byte Districts::occupancy( void ) { return( 1 ); }
+Districts districts;
+
+Query::Query( void ) {}
+void Query::process( void ) {}
+bool Query::start( UNUSED( Byte_Queue_API *port )) { queries++; return( true ); }
+bool Query::statistics( UNUSED( Byte_Queue_API *port )) { queries++; return( true ); }
+bool Query::bus( UNUSED( Byte_Queue_API *port )) { queries++; return( true ); }
+Query state_query;
+
+//
+//	The console: input is queued (releasing the protocol's
+//	control signal for each byte), output is kept in a line.
+//
+class Host_Console : public Byte_Queue_API {
+private:
+	static const byte	line_size = 64;
+
+	Byte_Queue_Signal< 64 >	_input;
+	char			_line[ line_size ];
+	byte			_len;
+
+public:
+	Host_Console( void ) {
+		_len = 0;
+		_line[ 0 ] = EOS;
+	}
+	bool feed( byte data ) {
+		return( _input.write( data ));
+	}
+	Signal *control_signal( void ) {
+		return( _input.control_signal());
+	}
+	const char *line( void ) {
+		return( _line );
+	}
+	void restart( void ) {
+		_len = 0;
+		_line[ 0 ] = EOS;
+	}
+	virtual bool write( byte data ) {
+		if( _len < line_size - 1 ) {
+			_line[ _len++ ] = data;
+			_line[ _len ] = EOS;
+		}
+		return( true );
+	}
+	virtual byte read( void ) {
+		return( _input.read());
+	}
+	virtual byte space( void ) {
+		return( MAXIMUM_BYTE );
+	}
+	virtual byte available( void ) {
+		return( _input.available());
+	}
+};
+
+//
+//	The parser under test.  The guards either side catch any
+//	write past the end of the object.
+//
+static const byte	guard_size = 16;
+static const byte	guard_fill = 0xa5;
+
+static struct {
+	byte		before[ guard_size ];
+	Protocol	engine;
+	byte		after[ guard_size ];
+} subject;
+
+static Host_Console	console_in;
+
+//
+//	Check handling.
+//
+static int failures = 0;
+
+#define CHECK(e)	do{ if(!(e)){ fprintf( stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #e ); failures++; }}while(false)
+
+static bool guards( void ) {
+	for( byte i = 0; i < guard_size; i++ ) {
+		if(( subject.before[ i ] != guard_fill )||( subject.after[ i ] != guard_fill )) return( false );
+	}
+	return( true );
+}
+
+//
+//	Pass bytes through the parser.
+//
+static void feed( const char *data, word len ) {
+	while( len-- ) {
+		CHECK( console_in.feed( *data++ ));
+		while( console_in.available()) task_manager.pole_task();
+	}
+}
+
+static void feed( const char *data ) {
+	feed( data, strlen( data ));
+}
+
+//
+//	The corpus.  Each entry gives the input and the number of
+//	packets it should add to the parsed and rejected counts.
+//
+struct sample {
+	const char	*input;
+	word		frames,
+			rejected;
+};
+
+static const sample corpus[] = {
+	{ "[S]",				1, 0 },
+	{ "[D]",				1, 0 },
+	{ "[I]",				1, 0 },
+	{ "[O]",				1, 0 },
+	{ "[ S ]",				1, 0 },
+	{ "[S\t]",				1, 0 },
+	{ "[S\r\n]",				1, 0 },
+	{ "noise [O] noise",			1, 0 },
+	{ "[]",					0, 1 },
+	{ "]",					0, 0 },
+	{ "[S\001]",				0, 1 },
+	{ "[S\177]",				0, 1 },
+	{ "[S\377]",				0, 1 },
+	{ "[S\200]",				0, 1 },
+	{ "[S\303\251]",			0, 1 },
+	{ "[S[O]",				1, 1 },
+	{ "[[[O]",				1, 2 },
+	{ "[O]]",				1, 0 },
+	{ "[X 1 2 3]",				1, 0 },
+	{ "[M 3 -127 999999999999]",		1, 0 },
+	{ "[S234567890123456789012345678901]",	1, 0 },
+	{ "[S2345678901234567890123456789012]",	0, 1 },
+	{ "[S2345678901234567890123456789012345678901234567890]", 0, 1 }
+};
+
+static void test_corpus( void ) {
+	for( word i = 0; i < sizeof( corpus ) / sizeof( sample ); i++ ) {
+		word	f, r;
+
+		f = subject.engine.frames();
+		r = subject.engine.rejected();
+		feed( corpus[ i ].input );
+		if(( subject.engine.frames() - f != corpus[ i ].frames )||( subject.engine.rejected() - r != corpus[ i ].rejected )) {
+			fprintf( stderr, "corpus %u: frames +%u (want %u) rejected +%u (want %u)\n", i,
+				subject.engine.frames() - f, corpus[ i ].frames,
+				subject.engine.rejected() - r, corpus[ i ].rejected );
+			failures++;
+		}
+	}
+	CHECK( guards());
+}
+
+static void test_replies( void ) {
+	word	q, e;
+
+	//
+	//	Occupancy is answered directly, the others start a
+	//	query, and an unknown command is an error.
+	//
+	console_in.restart();
+	feed( "[O]" );
+	CHECK( strcmp( console_in.line(), "[O2 1]\n" ) == 0 );
+	q = queries;
+	feed( "[S][D][I]" );
+	CHECK( queries == q + 3 );
+	e = errors.logged();
+	feed( "[X]" );
+	CHECK( errors.logged() == e + 1 );
+}
+
+//
+//	Random streams, made mostly of characters which mean
+//	something to the parser.  After each the parser must still
+//	accept a good packet.
+//
+static byte random_byte( void ) {
+	static const char	common[] = "[[]] \t\r\nSODIMX0123456789-";
+
+	switch( rand() % 4 ) {
+		case 0:  return( rand() & 0xff );
+		case 1:  return( 'A' + rand() % 26 );
+		default: return( common[ rand() % ( sizeof( common ) - 1 )]);
+	}
+}
+
+static void test_random( word streams ) {
+	char	stream[ 200 ];
+	word	len, f, r, marks;
+
+	srand( 1 );
+	for( word i = 0; i < streams; i++ ) {
+		len = rand() % sizeof( stream );
+		marks = 0;
+		for( word j = 0; j < len; j++ ) {
+			stream[ j ] = random_byte();
+			if(( stream[ j ] == Protocol::lead_in )||( stream[ j ] == Protocol::lead_out )) marks++;
+		}
+		f = subject.engine.frames();
+		r = subject.engine.rejected();
+		feed( stream, len );
+		//
+		//	Packets are only counted when a lead out closes
+		//	them or a lead in cuts them short.
+		//
+		CHECK(( subject.engine.frames() - f )+( subject.engine.rejected() - r ) <= marks );
+		//
+		//	Recovery: close whatever is open, then a good
+		//	packet must be parsed.
+		//
+		feed( "]" );
+		f = subject.engine.frames();
+		console_in.restart();
+		feed( "[O]" );
+		CHECK( subject.engine.frames() == f + 1 );
+		CHECK( strcmp( console_in.line(), "[O2 1]\n" ) == 0 );
+		CHECK( guards());
+		if( failures ) {
+			fprintf( stderr, "random stream %u failed\n", i );
+			return;
+		}
+	}
+}
+
+//
+//	Throughput.
+//
+static void bench( void ) {
+	static const char	mix[] = "[S][O] [D]\r\n[I][M 3 100][]noise[S\001][O]";
+	const word		rounds = 20000;
+	struct timespec		t0, t1;
+	double			secs;
+	word			f;
+
+	f = subject.engine.frames();
+	clock_gettime( CLOCK_MONOTONIC, &t0 );
+	for( word i = 0; i < rounds; i++ ) {
+		console_in.restart();
+		feed( mix );
+	}
+	clock_gettime( CLOCK_MONOTONIC, &t1 );
+	secs = ( t1.tv_sec - t0.tv_sec ) + ( t1.tv_nsec - t0.tv_nsec ) / 1e9;
+	printf( "Protocol parsing (host CPU):\n  %lu bytes, %u packets parsed in %.3fs, %.0f packets/s, %.0f bytes/s\n",
+		(dword)rounds * ( sizeof( mix ) - 1 ),
+		(word)( subject.engine.frames() - f ),
+		secs,
+		( subject.engine.frames() - f ) / secs,
+		rounds * ( sizeof( mix ) - 1 ) / secs );
+}
+
+int main( int argc, char *argv[] ) {
+	memset( subject.before, guard_fill, guard_size );
+	memset( subject.after, guard_fill, guard_size );
+	subject.engine.initialise( &console_in, console_in.control_signal());
+	test_corpus();
+	test_replies();
+	test_random( 20000 );
+	if(( argc > 1 )&&( strcmp( argv[ 1 ], "bench" ) == 0 )) bench();
+	if( failures ) {
+		fprintf( stderr, "%d checks failed\n", failures );
+		return( 1 );
+	}
+	printf( "All protocol tests passed\n" );
+	return( 0 );
+}
+
+//
+//	EOF
+//
@@ -0,0 +1,55 @@
+//
+//	TWI_Emulator.cpp
+//	================
+//
+//	Replaces TWI.cpp in the host build.  Transactions are passed
+//	straight to the emulated display (see LCD_Emulator.h), and
+//	complete (the result set and the flag released) once the
+//	simulated clock has moved on by the time they would have
+//	taken on the bus.  Anything sent to another address is not
+//	acknowledged.
+//
+//	Only the calls made by the LCD module are provided.
+//
+
+#include "../TWI.h"
+#include "../Clock.h"
+#include "LCD_Emulator.h"
+
+TWI::TWI( void ) {
+	_queue_len = 0;
+	_active = NIL( transaction );
+}
+
+//
+//	Complete a transaction which took "us" microseconds on
+//	the bus, or was not acknowledged if that is zero.
+//
+static void complete( word us, Signal *flag, TWI::error_code *result ) {
+	*result = us? TWI::error_none: TWI::error_address;
+	if( flag ) {
+		if( !us || !event_timer.delay_event( USECS( us ), flag, false )) flag->release();
+	}
+}
+
+bool TWI::send_data( byte adrs, byte *buffer, byte send, Signal *flag, error_code *result, UNUSED( priority level )) {
+	complete( lcd_emulator.send_data( adrs, buffer, send, micros()), flag, result );
+	return( true );
+}
+
+bool TWI::exchange( byte adrs, byte *buffer, byte send, byte recv, Signal *flag, error_code *result, UNUSED( priority level )) {
+	complete( lcd_emulator.exchange( adrs, buffer, send, recv, micros()), flag, result );
+	return( true );
+}
+
+void TWI::process( void ) {
+}
+
+//
+//	The TWI instance.
+//
+TWI twi;
+
+//
+//	EOF
+//